@@ -45,6 +45,11 @@
 
 #pragma mark - BLEAction
 
+- (BOOL)isReusable
+{
+    return YES;
+}
+
 - (void) performBeaconAction:(BLETrigger *)trigger forState:(BLEActionState)state eventType:(BLEEventType)eventType
 {
     switch (state) {
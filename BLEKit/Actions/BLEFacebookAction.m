@@ -31,7 +31,7 @@
 #import "BLEKit.h"
 #import "BLEKitPrivate.h"
 
-#import "SAMCache+BLEKit.h"
+#import "SAMCache.h"
 
 #import <FacebookSDK/FacebookSDK.h>
 
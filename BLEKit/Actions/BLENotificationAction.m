@@ -53,6 +53,11 @@
     }
 }
 
+- (BOOL)isReusable
+{
+    return YES;
+}
+
 - (BOOL)canPerformBeaconAction:(BLETrigger *)trigger forState:(BLEActionState)state eventType:(BLEEventType)eventType
 {
     return (state == BLEActionStateForeground);
@@ -130,6 +130,16 @@ static NSString * const BLETriggerUniqueIdentifierKey = @"ble_trigger_id";
  *  @return Boolean value
  */
 - (BOOL) handleURL:(NSURL *)url sourceApplication:(id)sourceApplication annotation:(id)annotation;
+
+/**
+ *  Check if action instance can be reused for subsequent events of the same trigger. Optional.
+ *
+ *  Reusable action is resolved on first event and then reused for the same trigger and event type,
+ *  instead of being resolved on every event. Return YES only if action doesn't keep state between performed actions.
+ *
+ *  @return YES if instance can be reused. NO by default.
+ */
+- (BOOL) isReusable;
 @end
 
 /**
@@ -31,7 +31,6 @@
 #import "BLEAction.h"
 #import "BLEKitPrivate.h"
 #import "UNCodingUtil.h"
-#import "SAMCache+BLEKit.h"
 
 @implementation BLEAction
 
@@ -108,6 +107,11 @@
     return NO;
 }
 
+- (BOOL)isReusable
+{
+    return NO;
+}
+
 #pragma mark - BLEUpdatableFromDictionary
 
 - (void)updatePropertiesFromDictionary:(NSDictionary *)dictionary
@@ -26,7 +26,7 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
-//  An app can register up to 20 regions at a time.
+//  An app can register up to 20 regions at a time. Beyond that BLEKit collapses beacons into wildcard regions and rotates them, see BLERegionPlanner.
 //  In order to report region changes in a timely manner, the region monitoring service requires network connectivity.
 
 #import <Foundation/Foundation.h>
@@ -35,10 +35,6 @@
 #import "BLEKitTypes.h"
 
 extern NSString * const BLEInvalidBeaconIdentifierException;
-extern NSString * const BLEBeaconTimerFireNotification;
-
-#define BLEBeaconStaysCacheName(beacon) \
-    [NSString stringWithFormat:@"com.up-next.BLEKit.stays.%@",beacon.identifier]
 
 @class BLELocation, BLEZone;
 @protocol BLEAction;
@@ -37,22 +37,24 @@
 #import "BLEKitPrivate.h"
 #import "CLBeacon+BLEKit.h"
 
-#import "SAMCache+BLEKit.h"
+#import "BLEStaysStore.h"
+#import "BLEBeaconIdentity.h"
 
 #import "UNCodingUtil.h"
 
-#define NSUINT_BIT (CHAR_BIT * sizeof(NSUInteger))
-#define NSUINTROTATE(val, howmuch) ((((NSUInteger)val) << howmuch) | (((NSUInteger)val) >> (NSUINT_BIT - howmuch)))
-
 NSString * const BLEInvalidBeaconIdentifierException = @"BLEInvalidBeaconIdentifier";
-NSString * const BLEBeaconTimerFireNotification = @"BLEBeaconTimerFireNotification";
-
-@interface BLEBeacon ()
-@property (strong) dispatch_source_t timer;
-@property (assign) BOOL timerIsActive;
-@end
 
-@implementation BLEBeacon
+@implementation BLEBeacon {
+    NSSet *_triggers;
+    /**
+     *  Triggers by event type, built lazily
+     */
+    NSDictionary *_triggersByEventType;
+    /**
+     *  Identity, rebuilt when proximityUUID, major or minor changes
+     */
+    BLEBeaconIdentity *_beaconIdentity;
+}
 
 @synthesize proximityUUID = _proximityUUID;
 @synthesize major = _major;
@@ -62,18 +64,6 @@ NSString * const BLEBeaconTimerFireNotification = @"BLEBeaconTimerFireNotificati
 @synthesize rssi = _rssi;
 @synthesize zone = _zone;
 
-- (instancetype) init
-{
-    if (self = [super init]) {
-        // remove only if period of time is significant
-        SAMCache *staysCache = [[SAMCache alloc] initWithName:BLEBeaconStaysCacheName(self)];
-        [staysCache removeAllObjects];
-        
-        [self scheduleStaysTimer];
-    }
-    return self;
-}
-
 - (instancetype) initWithZone:(BLEZone *)zone
 {
     if (self = [self init]) {
@@ -92,32 +82,79 @@ NSString * const BLEBeaconTimerFireNotification = @"BLEBeaconTimerFireNotificati
     return self;
 }
 
+#pragma mark - Identity
+
+- (void)setProximityUUID:(NSUUID *)proximityUUID
+{
+    @synchronized(self) {
+        _proximityUUID = proximityUUID;
+        _beaconIdentity = nil;
+    }
+}
+
+- (void)setMajor:(NSNumber *)major
+{
+    @synchronized(self) {
+        _major = major;
+        _beaconIdentity = nil;
+    }
+}
+
+- (void)setMinor:(NSNumber *)minor
+{
+    @synchronized(self) {
+        _minor = minor;
+        _beaconIdentity = nil;
+    }
+}
+
+- (BLEBeaconIdentity *) beaconIdentity
+{
+    @synchronized(self) {
+        if (!_beaconIdentity) {
+            _beaconIdentity = [BLEBeaconIdentity identityForBeacon:self];
+        }
+        return _beaconIdentity;
+    }
+}
+
+- (BLEBeaconKey) beaconKey
+{
+    return [self beaconIdentity].key;
+}
+
+- (void) setBeaconKey:(BLEBeaconKey)beaconKey
+{
+    @synchronized(self) {
+        _proximityUUID = [[NSUUID alloc] initWithUUIDBytes:beaconKey.proximityUUID];
+        _major = (beaconKey.fields & BLEBeaconKeyFieldMajor) ? @(beaconKey.major) : nil;
+        _minor = (beaconKey.fields & BLEBeaconKeyFieldMinor) ? @(beaconKey.minor) : nil;
+        _beaconIdentity = [BLEBeaconIdentity identityWithKey:beaconKey];
+    }
+}
+
 - (NSString *)identifier
 {
-    return self.blekit_identifier;
+    if (!self.proximityUUID) {
+        return self.blekit_identifier;
+    }
+    return [self beaconIdentity].stringValue;
 }
 
 - (BOOL)isEqual:(id)other
 {
-    if(![other isKindOfClass: [self class]])
+    if (other == self) {
         return YES;
-    
-    BOOL ret = NO;
-    if ([other respondsToSelector:@selector(identifier)]) {
-        ret = [[other identifier] isEqualToString:[self identifier]];
     }
-    
-    return ret;
+    if (![other isKindOfClass:[BLEBeacon class]]) {
+        return NO;
+    }
+    return [[self beaconIdentity] isEqualToIdentity:[other beaconIdentity]];
 }
 
 - (NSUInteger)hash
 {
-    NSUInteger outHash = [_proximityUUID hash];
-    outHash = NSUINTROTATE(outHash, NSUINT_BIT / 2) ^ [_major hash];
-    outHash = NSUINTROTATE(outHash, NSUINT_BIT / 2) ^ [_minor hash];
-    outHash = NSUINTROTATE(outHash, NSUINT_BIT / 2) ^ [_name hash];
-    outHash = NSUINTROTATE(outHash, NSUINT_BIT / 2) ^ [_desc hash];
-    return outHash;
+    return [[self beaconIdentity] hash];
 }
 
 - (NSString *) debugDescription
@@ -125,59 +162,63 @@ NSString * const BLEBeaconTimerFireNotification = @"BLEBeaconTimerFireNotificati
     return self.identifier;
 }
 
-- (NSTimeInterval) staysTimeInterval
+#pragma mark - Triggers
+
+- (NSSet *)triggers
 {
-    SAMCache *staysCache = [[SAMCache alloc] initWithName:BLEBeaconStaysCacheName(self)];
-    NSDate *lastEnter = [staysCache objectForKey:self.identifier];
-    if (lastEnter) {
-        return [[NSDate date] timeIntervalSinceDate:lastEnter];
+    @synchronized(self) {
+        return _triggers;
     }
-    return 0;
 }
 
-- (void) scheduleStaysTimer
+- (void)setTriggers:(NSSet *)triggers
 {
-    self.timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
-    if (self.timer)
-    {
-        __weak typeof(self)selfWeak = self;
-        
-        [[NSNotificationCenter defaultCenter] addObserverForName:UIApplicationDidEnterBackgroundNotification object:nil queue:nil usingBlock:^(NSNotification *note) {
-            __strong __typeof(self)selfStrong = selfWeak;
-            if (self.timerIsActive) {
-                dispatch_suspend(selfStrong.timer);
-                selfStrong.timerIsActive = NO;
-            }
-        }];
-        
-        [[NSNotificationCenter defaultCenter] addObserverForName:UIApplicationDidBecomeActiveNotification object:nil queue:nil usingBlock:^(NSNotification *note) {
-            __strong __typeof(self)selfStrong = selfWeak;
-            if (!self.timerIsActive) {
-                dispatch_resume(selfStrong.timer);
-                selfStrong.timerIsActive = YES;
-            }
-        }];
-        
-        
-        dispatch_source_set_timer(self.timer, dispatch_walltime(NULL, 0), 60 * NSEC_PER_SEC, 1 * NSEC_PER_SEC); // 1m, 1s
-        dispatch_source_set_event_handler(self.timer, ^{
-            __strong __typeof(self)selfStrong = selfWeak;
-            @synchronized(selfStrong) {
-#ifdef DEBUG
-                NSLog(@"%@ Time based event for beacon %@.", [self class], selfStrong);
-#endif
-                [[NSNotificationCenter defaultCenter] postNotificationName:BLEBeaconTimerFireNotification object:selfStrong];
+    @synchronized(self) {
+        _triggers = triggers;
+        _triggersByEventType = nil;
+    }
+}
+
+- (NSArray *) triggersForEventType:(BLEEventType)eventType
+{
+    @synchronized(self) {
+        if (!_triggersByEventType) {
+            NSMutableDictionary *triggersByEventType = [NSMutableDictionary dictionaryWithCapacity:BLEEventTypeTimer];
+            for (BLETrigger *trigger in _triggers) {
+                BLEEventType triggerEventType = [trigger eventType];
+                if (triggerEventType == BLEEventTypeUnknown) {
+                    continue;
+                }
+
+                NSMutableArray *triggers = triggersByEventType[@(triggerEventType)];
+                if (!triggers) {
+                    triggers = [NSMutableArray array];
+                    triggersByEventType[@(triggerEventType)] = triggers;
+                }
+                [triggers addObject:trigger];
             }
-        });
-        
-        self.timerIsActive = YES;
-        dispatch_resume(self.timer);
+            _triggersByEventType = [triggersByEventType copy];
+        }
+        return _triggersByEventType[@(eventType)];
     }
 }
 
+- (NSTimeInterval) staysTimeInterval
+{
+    return [[BLEStaysStore sharedStore] staysTimeIntervalForIdentifier:self.identifier];
+}
+
 #pragma mark - BLEUpdatableFromDictionary
 
 - (void)updatePropertiesFromDictionary:(NSDictionary *)dictionary
+{
+    NSError *error = nil;
+    if (![self updatePropertiesFromDictionary:dictionary error:&error]) {
+        @throw [NSException exceptionWithName:BLEInvalidBeaconIdentifierException reason:error.localizedDescription userInfo:dictionary];
+    }
+}
+
+- (BOOL) updatePropertiesFromDictionary:(NSDictionary *)dictionary error:(NSError * __autoreleasing *)error
 {
     self->_desc = dictionary[@"description"];
     self->_name = dictionary[@"name"];
@@ -206,34 +247,13 @@ NSString * const BLEBeaconTimerFireNotification = @"BLEBeaconTimerFireNotificati
     }
 
     if (dictionary[@"id"]) {
-        NSString *idString = [dictionary[@"id"] description];
-        NSError *error = NULL;
-        
-        NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:@"^([\\w-]*)(\\+(\\d*)){0,1}(\\+(\\d*)){0,1}" options:NSRegularExpressionCaseInsensitive | NSRegularExpressionAnchorsMatchLines error:&error];
-        NSArray *matches =  [regex matchesInString:idString
-                                           options:0
-                                             range:NSMakeRange(0, [idString length])];
-        
-        NSTextCheckingResult *match = [matches objectAtIndex:0];
-        for (int idx = 1; idx < match.numberOfRanges; idx++) {
-            NSRange range = [match rangeAtIndex:idx];
-            if (range.location != NSNotFound && idx == 1) {
-                self.proximityUUID = [[NSUUID alloc] initWithUUIDString:[idString substringWithRange:range]];
-            }
-
-            if (range.location != NSNotFound && idx == 3) {
-                self.major = @([[idString substringWithRange:range] integerValue]);
-            }
-
-            if (range.location != NSNotFound && idx == 5) {
-                self.minor = @([[idString substringWithRange:range] integerValue]);
-            }
-        }
-        
-        if (!self.proximityUUID) {
-            @throw [NSException exceptionWithName:BLEInvalidBeaconIdentifierException reason:[NSString stringWithFormat:@"Defined beacon identifier '%@' is invalid", idString] userInfo:dictionary];
+        BLEBeaconKey beaconKey;
+        if (!BLEBeaconKeyFromString([dictionary[@"id"] description], &beaconKey, error)) {
+            return NO;
         }
+        [self setBeaconKey:beaconKey];
     }
+    return YES;
 }
 
 #pragma mark - NSCopying
@@ -32,21 +32,45 @@
 
 @class BLETrigger, BLECondition;
 
+/**
+ *  Condition type parsed from type string
+ */
+typedef NS_ENUM(NSInteger, BLEConditionType) {
+    BLEConditionTypeUnknown = 0,
+    BLEConditionTypeEnter,
+    BLEConditionTypeLeave,
+    BLEConditionTypeCameNear,
+    BLEConditionTypeCameFar,
+    BLEConditionTypeCameImmediate,
+    BLEConditionTypeIsNear,
+    BLEConditionTypeIsFar,
+    BLEConditionTypeIsImmediate,
+    BLEConditionTypeStays
+};
+
 @interface BLECondition : NSObject <NSSecureCoding>
 
 
 /**
  *  Type of condition
  */
-@property (strong) NSString *type;
+@property (strong, nonatomic) NSString *type;
+/**
+ *  Type of condition parsed from @c type
+ */
+@property (assign, nonatomic, readonly) BLEConditionType conditionType;
+/**
+ *  Event type condition can be valid for, BLEEventTypeUnknown if never valid
+ */
+@property (assign, nonatomic, readonly) BLEEventType eventType;
 /**
  *  Parameters for condition
  */
-@property (strong) NSDictionary *parameters;
+@property (strong, nonatomic) NSDictionary *parameters;
 /**
  *  Expression string
  */
-@property (strong) NSString *expression;
+@property (strong, nonatomic) NSString *expression;
 
 /**
  *  Trigger for condition
@@ -81,4 +105,21 @@
  */
 - (BOOL) validateForParameters:(BOOL)withOccurrency;
 
+/**
+ *  Validate parameters for given occurrence instead of the stored one.
+ *
+ *  @param withOccurrency count as occurrence
+ *  @param occurrence     occurrence value
+ *
+ *  @return YES if parameters are valid with the current state of beacon
+ */
+- (BOOL) validateForParameters:(BOOL)withOccurrency occurrence:(NSInteger)occurrence;
+
+/**
+ *  Check if parameters or expression depends on occurrence
+ *
+ *  @return YES if validation result depends on occurrence
+ */
+- (BOOL) usesOccurrence;
+
 @end
@@ -29,18 +29,134 @@
 #import "BLECondition.h"
 #import "BLEKitPrivate.h"
 #import "UNCodingUtil.h"
+#import "BLEConditionExpression.h"
 
-#import "SAMCache+BLEKit.h"
+#import "BLEOccurrenceStore.h"
 
-static NSString * const BLEConditionTypeStays = @"stays";
 static NSString * const BLEConditionStaysKey = @"stays";
 static NSString * const BLEConditionStaysIntervalKey = @"interval";
 static NSString * const BLEConditionOccurrenceKey = @"occurrence";
 
-@interface BLECondition ()
+/**
+ *  Proximity value matching any proximity
+ */
+#define BLEConditionAnyProximity -1
+
+/**
+ *  Event type and required proximity for condition type
+ */
+static const struct {
+    BLEEventType eventType;
+    NSInteger proximity;
+} BLEConditionTypeDispatch[] = {
+    [BLEConditionTypeUnknown]       = {BLEEventTypeUnknown, BLEConditionAnyProximity},
+    [BLEConditionTypeEnter]         = {BLEEventTypeEnter,   BLEConditionAnyProximity},
+    [BLEConditionTypeLeave]         = {BLEEventTypeLeave,   BLEConditionAnyProximity},
+    [BLEConditionTypeCameNear]      = {BLEEventTypeRange,   CLProximityNear},
+    [BLEConditionTypeCameFar]       = {BLEEventTypeRange,   CLProximityFar},
+    [BLEConditionTypeCameImmediate] = {BLEEventTypeRange,   CLProximityImmediate},
+    [BLEConditionTypeIsNear]        = {BLEEventTypeRange,   CLProximityNear},
+    [BLEConditionTypeIsFar]         = {BLEEventTypeRange,   CLProximityFar},
+    [BLEConditionTypeIsImmediate]   = {BLEEventTypeRange,   CLProximityImmediate},
+    [BLEConditionTypeStays]         = {BLEEventTypeTimer,   BLEConditionAnyProximity}
+};
+
+static BLEConditionType BLEConditionTypeFromString(NSString *type)
+{
+    static NSDictionary *types = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        types = @{@"enter": @(BLEConditionTypeEnter),
+                  @"leave": @(BLEConditionTypeLeave),
+                  @"cameNear": @(BLEConditionTypeCameNear),
+                  @"cameFar": @(BLEConditionTypeCameFar),
+                  @"cameImmediate": @(BLEConditionTypeCameImmediate),
+                  @"isNear": @(BLEConditionTypeIsNear),
+                  @"isFar": @(BLEConditionTypeIsFar),
+                  @"isImmediate": @(BLEConditionTypeIsImmediate),
+                  @"stays": @(BLEConditionTypeStays)};
+    });
+    return type ? [types[type] integerValue] : BLEConditionTypeUnknown;
+}
+
+@interface BLECondition () <BLEConditionExpressionContext>
 @end
 
-@implementation BLECondition
+/**
+ *  Context of single condition evaluation. Carries occurrence the condition is evaluated for,
+ *  everything else is read from condition.
+ */
+@interface BLEConditionEvaluation : NSObject <BLEConditionExpressionContext>
+- (instancetype) initWithCondition:(BLECondition *)condition occurrence:(NSNumber *)occurrence;
+@end
+
+@implementation BLEConditionEvaluation {
+    BLECondition *_condition;
+    NSNumber *_occurrence;
+}
+
+- (instancetype) initWithCondition:(BLECondition *)condition occurrence:(NSNumber *)occurrence
+{
+    if (self = [super init]) {
+        self->_condition = condition;
+        self->_occurrence = occurrence;
+    }
+    return self;
+}
+
+- (double) conditionExpression:(BLEConditionExpression *)expression numberForSlot:(BLEConditionExpressionSlot)slot
+{
+    if (slot == BLEConditionExpressionSlotOccurrence) {
+        return [_occurrence doubleValue];
+    }
+    return [_condition conditionExpression:expression numberForSlot:slot];
+}
+
+- (NSString *) conditionExpression:(BLEConditionExpression *)expression stringForSlot:(BLEConditionExpressionSlot)slot
+{
+    return [_condition conditionExpression:expression stringForSlot:slot];
+}
+
+#pragma mark - NSKeyValueCoding
+
+/**
+ *  Key paths of NSPredicate are resolved on condition
+ */
+- (id)valueForKey:(NSString *)key
+{
+    if ([key isEqualToString:BLEConditionOccurrenceKey]) {
+        return _occurrence;
+    }
+    return [_condition valueForKey:key];
+}
+
+@end
+
+@implementation BLECondition {
+    /**
+     *  Native compiled expression and parameters
+     */
+    BLEConditionExpression *_nativeExpression;
+    BLEConditionExpression *_nativeParameters;
+    BLEConditionExpression *_nativeParametersWithoutOccurrence;
+    /**
+     *  Compatibility NSPredicate for expression not supported natively, constant variables are already substituted
+     */
+    NSPredicate *_expressionPredicate;
+    /**
+     *  Expression or parameters can't be compiled, condition never matches
+     */
+    BOOL _invalid;
+    BOOL _expressionUsesOccurrence;
+    BOOL _expressionUsesStays;
+    /**
+     *  Compiled "AND" predicates for parameters
+     */
+    NSPredicate *_parametersPredicate;
+    NSPredicate *_parametersPredicateWithoutOccurrence;
+    BOOL _usesOccurrence;
+    BOOL _compiled;
+}
 
 - (id)init
 {
@@ -72,11 +188,10 @@ static NSString * const BLEConditionOccurrenceKey = @"occurrence";
 //    NSDate *yesterday = [cal dateByAddingComponents:components toDate:today options:0];
     
     __strong __typeof(self.trigger)triggerStrong = self.trigger;
-    __strong __typeof(self.trigger.beacon)beaconStrong = triggerStrong.beacon;
-    
-    NSNumber *occurrence = [[SAMCache actionCache] objectForKey:BLECacheActionIdentifierFormat(triggerStrong.action, beaconStrong)];
-    NSNumber *ret = occurrence ?: @(0);
-    return ret;
+    if (!triggerStrong) {
+        return @(0);
+    }
+    return @([[BLEOccurrenceStore sharedStore] valueAtSlot:[triggerStrong occurrenceSlot]]);
 }
 
 /**
@@ -89,33 +204,18 @@ static NSString * const BLEConditionOccurrenceKey = @"occurrence";
     return value;
 }
 
+- (BLEEventType)eventType
+{
+    return BLEConditionTypeDispatch[_conditionType].eventType;
+}
+
 - (BOOL) validateForEventType:(BLEEventType)eventType
 {
     BOOL ret = NO;
-    
-    if (!ret && self.type) {
-        BLETrigger *trigger = self.trigger;
-        BLEBeacon  *beacon  = trigger.beacon;
-        
-        if ([self.type isEqualToString:@"enter"] && eventType == BLEEventTypeEnter) {
-            ret = YES;
-        } else if ([self.type isEqualToString:@"leave"] && eventType == BLEEventTypeLeave) {
-            ret = YES;
-        } else if ([self.type isEqualToString:@"cameNear"] && eventType == BLEEventTypeRange && beacon.proximity == CLProximityNear) {
-            ret = YES;
-        } else if ([self.type isEqualToString:@"cameFar"] && eventType == BLEEventTypeRange && beacon.proximity == CLProximityFar) {
-            ret = YES;
-        } else if ([self.type isEqualToString:@"cameImmediate"] && eventType == BLEEventTypeRange && beacon.proximity == CLProximityImmediate) {
-            ret = YES;
-        } else if ([self.type isEqualToString:@"isNear"] && eventType == BLEEventTypeRange && beacon.proximity == CLProximityNear) {
-            ret = YES;
-        } else if ([self.type isEqualToString:@"isFar"] && eventType == BLEEventTypeRange && beacon.proximity == CLProximityFar) {
-            ret = YES;
-        } else if ([self.type isEqualToString:@"isImmediate"] && eventType == BLEEventTypeRange && beacon.proximity == CLProximityImmediate) {
-            ret = YES;
-        } else if ([self.type isEqualToString:BLEConditionTypeStays] && eventType == BLEEventTypeTimer) {
-            ret = YES;
-        }
+
+    if (eventType != BLEEventTypeUnknown && BLEConditionTypeDispatch[_conditionType].eventType == eventType) {
+        NSInteger proximity = BLEConditionTypeDispatch[_conditionType].proximity;
+        ret = proximity == BLEConditionAnyProximity || proximity == self.trigger.beacon.proximity;
     }
 
     //TODO: httpOk
@@ -124,26 +224,145 @@ static NSString * const BLEConditionOccurrenceKey = @"occurrence";
 }
 
 - (BOOL) validateForParameters:(BOOL)withOccurrency
+{
+    return [self validateForParameters:withOccurrency inEvaluation:[[BLEConditionEvaluation alloc] initWithCondition:self occurrence:[self occurrenceValue]]];
+}
+
+- (BOOL) validateForParameters:(BOOL)withOccurrency occurrence:(NSInteger)occurrence
+{
+    return [self validateForParameters:withOccurrency inEvaluation:[[BLEConditionEvaluation alloc] initWithCondition:self occurrence:@(occurrence)]];
+}
+
+- (BOOL) validateForParameters:(BOOL)withOccurrency inEvaluation:(BLEConditionEvaluation *)evaluation
 {
     BOOL ret = NO;
+
+    if (!_compiled) {
+        [self compile];
+    }
+
+    if (_invalid) {
+        return NO;
+    }
+
+    if (_nativeExpression) {
+        ret = [_nativeExpression evaluateWithContext:evaluation];
+    } else if (_expressionPredicate) {
+        // bind dynamic variables only
+        NSMutableDictionary *bindings = [NSMutableDictionary dictionaryWithCapacity:2];
+        if (_expressionUsesOccurrence) {
+            bindings[BLEConditionOccurrenceKey] = [evaluation valueForKey:BLEConditionOccurrenceKey];
+        }
+        if (_expressionUsesStays) {
+            bindings[BLEConditionStaysKey] = [self staysValue];
+        }
+        ret = [_expressionPredicate evaluateWithObject:evaluation substitutionVariables:bindings];
+    }
+    
+    if (!ret && self.parameters && _nativeParameters) {
+        BLEConditionExpression *finalExpression = withOccurrency ? _nativeParameters : _nativeParametersWithoutOccurrence;
+        ret = [finalExpression evaluateWithContext:evaluation];
+    } else if (!ret && self.parameters) {
+        NSPredicate *finalPredicate = withOccurrency ? _parametersPredicate : _parametersPredicateWithoutOccurrence;
+        ret = [finalPredicate evaluateWithObject:evaluation];
+    }
     
+    if (!ret && !self.parameters && !self.expression) {
+        ret = YES;
+    }
+    
+    return ret;
+}
+
+- (BOOL) usesOccurrence
+{
+    if (!_compiled) {
+        [self compile];
+    }
+    return _usesOccurrence;
+}
+
+#pragma mark - Compilation
+
+/**
+ *  Compile expression and parameters. Native evaluator is preferred, NSPredicate is used
+ *  for expressions the native evaluator doesn't support. Condition NSPredicate can't parse never matches.
+ */
+- (void) compile
+{
+    @try {
+        _invalid = NO;
+        [self compileExpressionAndParameters];
+    }
+    @catch (NSException *exception) {
+#ifdef DEBUG
+        NSLog(@"Condition %@ is invalid and never matches. %@", self.type, exception.reason);
+#endif
+        _invalid = YES;
+        _nativeExpression = nil;
+        _nativeParameters = nil;
+        _nativeParametersWithoutOccurrence = nil;
+        _expressionPredicate = nil;
+        _parametersPredicate = nil;
+        _parametersPredicateWithoutOccurrence = nil;
+        _usesOccurrence = NO;
+    }
+    _compiled = YES;
+}
+
+- (void) compileExpressionAndParameters
+{
+    _nativeExpression = nil;
+    _nativeParameters = nil;
+    _nativeParametersWithoutOccurrence = nil;
+    _expressionPredicate = nil;
+    _parametersPredicate = nil;
+    _parametersPredicateWithoutOccurrence = nil;
+    _usesOccurrence = self.parameters[BLEConditionOccurrenceKey] != nil;
+
     if (self.expression) {
-        ret = NO;
+        NSError *error = nil;
+        _nativeExpression = [[BLEConditionExpression alloc] initWithString:self.expression error:&error];
+#ifdef DEBUG
+        if (!_nativeExpression) {
+            NSLog(@"Condition expression evaluated with NSPredicate. %@", error.localizedDescription);
+        }
+#endif
+    }
+
+    if (_nativeExpression) {
+        _usesOccurrence = _usesOccurrence || [_nativeExpression usesSlot:BLEConditionExpressionSlotOccurrence];
+    } else if (self.expression) {
+        _usesOccurrence = _usesOccurrence || [self.expression rangeOfString:BLEConditionOccurrenceKey].location != NSNotFound;
+    }
+
+    if (self.expression && !_nativeExpression) {
         NSPredicate *predicate = [NSPredicate predicateWithFormat:self.expression];
-        predicate = [predicate predicateWithSubstitutionVariables:@{@"isNear": @(CLProximityNear),
-                                                                    @"isImmediate": @(CLProximityImmediate),
-                                                                    @"isFar": @(CLProximityFar),
-                                                                    @"cameNear": @(CLProximityNear),
-                                                                    @"cameImmediate": @(CLProximityImmediate),
-                                                                    @"cameFar": @(CLProximityFar),
-                                                                    BLEConditionOccurrenceKey: [self occurrenceValue],
-                                                                    BLEConditionStaysKey: [self staysValue]
-                                                                    }];
-        ret = [predicate evaluateWithObject:self];
+        // substitute constant variables once, occurrence and stays stay as variables
+        _expressionUsesOccurrence = [self.expression rangeOfString:[@"$" stringByAppendingString:BLEConditionOccurrenceKey]].location != NSNotFound;
+        _expressionUsesStays = [self.expression rangeOfString:[@"$" stringByAppendingString:BLEConditionStaysKey]].location != NSNotFound;
+
+        _expressionPredicate = [predicate predicateWithSubstitutionVariables:@{@"isNear": @(CLProximityNear),
+                                                                               @"isImmediate": @(CLProximityImmediate),
+                                                                               @"isFar": @(CLProximityFar),
+                                                                               @"cameNear": @(CLProximityNear),
+                                                                               @"cameImmediate": @(CLProximityImmediate),
+                                                                               @"cameFar": @(CLProximityFar)
+                                                                               }];
     }
-    
-    if (!ret && self.parameters) {
-        NSMutableArray *predicates = [[NSMutableArray alloc] initWithCapacity:1];
+
+    if (self.parameters) {
+        NSSet *greaterOrEqualKeys = _conditionType == BLEConditionTypeStays ? [NSSet setWithObject:BLEConditionStaysIntervalKey] : nil;
+        _nativeParameters = [[BLEConditionExpression alloc] initWithParameters:self.parameters greaterOrEqualKeys:greaterOrEqualKeys excludedKeys:nil error:nil];
+        _nativeParametersWithoutOccurrence = [[BLEConditionExpression alloc] initWithParameters:self.parameters greaterOrEqualKeys:greaterOrEqualKeys excludedKeys:[NSSet setWithObject:BLEConditionOccurrenceKey] error:nil];
+        if (!_nativeParametersWithoutOccurrence) {
+            _nativeParameters = nil;
+        }
+    }
+
+    if (self.parameters && !_nativeParameters) {
+        NSMutableArray *predicates = [[NSMutableArray alloc] initWithCapacity:self.parameters.count];
+        NSMutableArray *predicatesWithoutOccurrence = [[NSMutableArray alloc] initWithCapacity:self.parameters.count];
 
         /**
          *  Build "AND" predicate with parameters from json
@@ -151,31 +370,153 @@ static NSString * const BLEConditionOccurrenceKey = @"occurrence";
 
         NSDictionary *dict = self.parameters;
         for (NSString *key in [dict allKeys]) {
-            
-            if (!withOccurrency && [key isEqualToString:BLEConditionOccurrenceKey]) {
-                // skip occurence
-                continue;
-            }
-            
             id value = dict[key];
             NSPredicate *singlePredicate = nil;
-            if ([self.type isEqualToString:BLEConditionTypeStays] && [key isEqualToString:BLEConditionStaysIntervalKey]) { //change it to more general configuration
+            if (_conditionType == BLEConditionTypeStays && [key isEqualToString:BLEConditionStaysIntervalKey]) { //change it to more general configuration
                 singlePredicate = [NSPredicate predicateWithFormat:@"%K >= %@",key, @([value integerValue])];
             } else {
                 singlePredicate = [NSPredicate predicateWithFormat:@"%K = %@",key, value];
             }
             [predicates addObject:singlePredicate];
+
+            if (![key isEqualToString:BLEConditionOccurrenceKey]) {
+                [predicatesWithoutOccurrence addObject:singlePredicate];
+            }
         }
-        
-        NSPredicate *finalPredicate = [NSCompoundPredicate andPredicateWithSubpredicates:predicates];
-        ret = [finalPredicate evaluateWithObject:self];
+
+        _parametersPredicate = [NSCompoundPredicate andPredicateWithSubpredicates:predicates];
+        _parametersPredicateWithoutOccurrence = [NSCompoundPredicate andPredicateWithSubpredicates:predicatesWithoutOccurrence];
     }
-    
-    if (!ret && !self.parameters && !self.expression) {
-        ret = YES;
+}
+
+- (BLEConditionExpression *) nativeExpression
+{
+    if (!_compiled) {
+        [self compile];
+    }
+    return _nativeExpression;
+}
+
+- (BLEConditionExpression *) nativeParameters
+{
+    if (!_compiled) {
+        [self compile];
+    }
+    return _nativeParameters;
+}
+
+- (BLEConditionExpression *) nativeParametersWithoutOccurrence
+{
+    if (!_compiled) {
+        [self compile];
+    }
+    return _nativeParametersWithoutOccurrence;
+}
+
+- (void) updateWithType:(NSString *)type
+             parameters:(NSDictionary *)parameters
+             expression:(NSString *)expression
+       nativeExpression:(BLEConditionExpression *)nativeExpression
+       nativeParameters:(BLEConditionExpression *)nativeParameters
+nativeParametersWithoutOccurrence:(BLEConditionExpression *)nativeParametersWithoutOccurrence
+{
+    self->_type = type;
+    self->_conditionType = BLEConditionTypeFromString(type);
+    self->_parameters = parameters;
+    self->_expression = expression;
+
+    if ((expression && !nativeExpression) || (parameters && (!nativeParameters || !nativeParametersWithoutOccurrence))) {
+        // NSPredicate fallback
+        [self compile];
+        return;
+    }
+
+    _invalid = NO;
+    _nativeExpression = nativeExpression;
+    _nativeParameters = nativeParameters;
+    _nativeParametersWithoutOccurrence = nativeParametersWithoutOccurrence;
+    _expressionPredicate = nil;
+    _parametersPredicate = nil;
+    _parametersPredicateWithoutOccurrence = nil;
+    _usesOccurrence = [nativeParameters usesSlot:BLEConditionExpressionSlotOccurrence] || [nativeExpression usesSlot:BLEConditionExpressionSlotOccurrence];
+    _compiled = YES;
+}
+
+#pragma mark - Setters
+
+- (void)setType:(NSString *)type
+{
+    _type = type;
+    _conditionType = BLEConditionTypeFromString(type);
+    _compiled = NO;
+}
+
+- (void)setParameters:(NSDictionary *)parameters
+{
+    _parameters = parameters;
+    _compiled = NO;
+}
+
+- (void)setExpression:(NSString *)expression
+{
+    _expression = expression;
+    _compiled = NO;
+}
+
+#pragma mark - BLEConditionExpressionContext
+
+- (double) conditionExpression:(BLEConditionExpression *)expression numberForSlot:(BLEConditionExpressionSlot)slot
+{
+    BLEBeacon *beacon = self.trigger.beacon;
+
+    switch (slot) {
+        case BLEConditionExpressionSlotDistance:
+        case BLEConditionExpressionSlotBeaconProximity:
+            return beacon ? beacon.proximity : NAN;
+        case BLEConditionExpressionSlotBeaconAccuracy:
+            return beacon ? beacon.accuracy : NAN;
+        case BLEConditionExpressionSlotBeaconRSSI:
+            return beacon ? beacon.rssi : NAN;
+        case BLEConditionExpressionSlotOccurrence:
+            return [[self occurrenceValue] doubleValue];
+        case BLEConditionExpressionSlotStays:
+            return beacon.staysTimeInterval;
+        case BLEConditionExpressionSlotStaysInterval:
+            return _conditionType == BLEConditionTypeStays ? beacon.staysTimeInterval : NAN;
+        default:
+            return NAN;
+    }
+}
+
+- (NSString *) conditionExpression:(BLEConditionExpression *)expression stringForSlot:(BLEConditionExpressionSlot)slot
+{
+    BLETrigger *trigger = self.trigger;
+    BLEBeacon  *beacon  = trigger.beacon;
+
+    switch (slot) {
+        case BLEConditionExpressionSlotBeaconIdentifier:
+            return beacon.identifier;
+        case BLEConditionExpressionSlotBeaconName:
+            return beacon.name;
+        case BLEConditionExpressionSlotBeaconDesc:
+            return beacon.desc;
+        case BLEConditionExpressionSlotZoneIdentifier:
+            return beacon.zone.identifier;
+        case BLEConditionExpressionSlotZoneName:
+            return beacon.zone.name;
+        case BLEConditionExpressionSlotZoneDesc:
+            return beacon.zone.desc;
+        case BLEConditionExpressionSlotActionType:
+            return [trigger.action type];
+        case BLEConditionExpressionSlotActionUniqueIdentifier:
+            return [trigger.action uniqueIdentifier];
+        case BLEConditionExpressionSlotTriggerName:
+            return trigger.name;
+        case BLEConditionExpressionSlotTriggerUniqueIdentifier:
+            return trigger.uniqueIdentifier;
+        default:
+            return nil;
     }
-    
-    return ret;
 }
 
 #pragma mark - NSKeyValueCoding
@@ -233,7 +574,7 @@ static NSString * const BLEConditionOccurrenceKey = @"occurrence";
         return @(beacon.proximity);
     } else if ([key isEqualToString:BLEConditionOccurrenceKey]) {
         return [self occurrenceValue];
-    } else if ([condition.type isEqualToString:BLEConditionTypeStays] && [key isEqualToString:BLEConditionStaysIntervalKey]) {
+    } else if (condition.conditionType == BLEConditionTypeStays && [key isEqualToString:BLEConditionStaysIntervalKey]) {
         return [self staysValue];
     }
     return nil;
@@ -244,8 +585,10 @@ static NSString * const BLEConditionOccurrenceKey = @"occurrence";
 - (void)updatePropertiesFromDictionary:(NSDictionary *)dictionary
 {
     self->_type = dictionary[@"type"];
+    self->_conditionType = BLEConditionTypeFromString(self->_type);
     self->_parameters = ![dictionary[@"parameters"] isKindOfClass:[NSNull class]] ? dictionary[@"parameters"] : nil;
     self->_expression = ![dictionary[@"expression"] isKindOfClass:[NSNull class]] ? dictionary[@"expression"] : nil;
+    [self compile];
 }
 
 #pragma mark - NSSecureCoding
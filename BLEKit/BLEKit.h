@@ -59,6 +59,9 @@ static NSString * const BLEBluetoothAvailableNotification = @"BLEBletoothAvailab
 
 /**
  *  BLEKit Class. Main class for the framework.
+ *
+ *  Methods can be called from any thread. Location and timer events are delivered on main queue,
+ *  changes of beacons and leave delays made from other threads are applied on main queue asynchronously.
  */
 @interface BLEKit : NSObject
 
@@ -76,6 +79,15 @@ static NSString * const BLEBluetoothAvailableNotification = @"BLEBletoothAvailab
  *  Processing status. YES if processing is paused.
  */
 @property (assign) BOOL paused;
+/**
+ *  Total time spent ranging beacons. Ranging runs only for regions with proximity triggers and backs off while proximity is stable.
+ */
+@property (assign, readonly) NSTimeInterval rangingTimeInterval;
+/**
+ *  Delay of leave event in seconds, default 15. Leave is cancelled if beacon is entered again within delay.
+ *  Beacon can override it with "leave_delay" parameter. Set from other thread, applied on main queue.
+ */
+@property (assign) NSTimeInterval leaveDelay;
 /**
  *  @see BLEKitDelegate
  */
@@ -131,6 +143,7 @@ static NSString * const BLEBluetoothAvailableNotification = @"BLEBletoothAvailab
 
 /**
  *  Allocate and initialize BLEKit with JSON file at given URL.
+ *  Synchronous, blocks on network for remote URL. @see kitWithZoneAtURL:completion:
  *
  *  @param url   URL to JSON
  *  @param error error or nil
@@ -139,6 +152,44 @@ static NSString * const BLEBluetoothAvailableNotification = @"BLEBletoothAvailab
  */
 + (BLEKit *) kitWithZoneAtURL:(NSURL *)url error:(NSError * __autoreleasing *)error;
 
+/**
+ *  Allocate and initialize BLEKit with zone at given URL. Asynchronous.
+ *
+ *  Kit is returned immediately with cached zone, or without beacons if zone is not cached yet.
+ *  Zone is fetched and parsed in background and swapped in when it changed.
+ *
+ *  @param url        URL to JSON
+ *  @param completion called on main queue when zone is up to date, error or nil
+ *
+ *  @return Initialized object
+ */
++ (BLEKit *) kitWithZoneAtURL:(NSURL *)url completion:(void(^)(BLEKit *kit, NSError *error))completion;
+
+/**
+ *  Replace zone without restarting. Beacons are matched by identifier, only added and
+ *  removed beacons start or stop monitoring. Unchanged beacons keep proximity, stays and
+ *  scheduled events.
+ *
+ *  @param zone Replacement zone
+ */
+- (void) reloadWithZone:(BLEZone *)zone;
+
+/**
+ *  Set leave delay for beacons of zone. Takes precedence over leaveDelay.
+ *
+ *  @param delay Delay in seconds, negative value removes override
+ *  @param zone  Zone
+ */
+- (void) setLeaveDelay:(NSTimeInterval)delay forZone:(BLEZone *)zone;
+
+/**
+ *  Set leave delay for beacon. Takes precedence over "leave_delay" parameter and zone delay.
+ *
+ *  @param delay  Delay in seconds, negative value removes override
+ *  @param beacon Beacon
+ */
+- (void) setLeaveDelay:(NSTimeInterval)delay forBeacon:(BLEBeacon *)beacon;
+
 /**
  *  Register class handler for given action type
  *
@@ -35,9 +35,19 @@
 
 #import "UNURLConnection.h"
 
-#import "SAMCache+BLEKit.h"
 #import "BLEBeaconsRangeBatch.h"
-#import "BLEEventScheduler.h"
+#import "BLEBeaconsIndex.h"
+#import "BLEDebounceEngine.h"
+#import "BLEStaysTimerWheel.h"
+#import "BLEStaysStore.h"
+#import "BLEOccurrenceStore.h"
+#import "BLEStateFile.h"
+#import "BLEZoneSnapshot.h"
+#import "BLEZoneRepository.h"
+#import "BLEZoneDiff.h"
+#import "BLERegionPlanner.h"
+#import "BLERangingScheduler.h"
+#import "BLEProximityEstimator.h"
 
 #import <UIKit/UIKit.h>
 #import <CoreBluetooth/CoreBluetooth.h>
@@ -45,7 +55,8 @@
 
 #import <FacebookSDK/FacebookSDK.h>
 
-#define BLEDelayEventTimeInterval 15
+#define BLEStaysEventTimeInterval 60
+#define BLEStaysEventResolution 5
 
 /**
  *  Did receive local notification
@@ -57,18 +68,45 @@ static NSString * const BLEDidReceiveNotification = @"BLEDidReceivePushNotificat
 static NSString * const BLEDidReceiveLocalUserInfoKey = @"BLEDidReceiveLocalUserInfoKey";
 static NSString * const BLEDidReceiveRemoteUserInfoKey = @"BLEDidReceiveRemoteUserInfoKey";
 
-static NSString * const monitoredRegionIdentifiersKey = @"monitoredRegionIdentifiers";
 static NSString * const sourceApplicationKey = @"sourceApplication";
 static NSString * const annotationKey = @"annotation";
 static NSString * const urlKey = @"url";
 
+/**
+ *  Run block on main queue, synchronously if called on main thread. Stays wheel and leave debouncer are main queue only.
+ */
+static void BLEKitPerformOnMainQueue(dispatch_block_t block)
+{
+    if ([NSThread isMainThread]) {
+        block();
+    } else {
+        dispatch_async(dispatch_get_main_queue(), block);
+    }
+}
+
 static NSMapTable *BLECustomActionClassess;
+/**
+ *  Incremented on every class registration, resolved actions are invalidated then.
+ */
+static NSUInteger BLECustomActionClassessGeneration;
 
-@interface BLEKit () <CLLocationManagerDelegate, CBCentralManagerDelegate, BLEBeaconsRangeBatchDelegate>
+@interface BLEKit () <CLLocationManagerDelegate, CBCentralManagerDelegate, BLEBeaconsRangeBatchDelegate, BLEStaysTimerWheelDelegate, BLERangingSchedulerDelegate>
 /**
  *  Beacons r/w
  */
 @property (strong, readwrite) NSSet *beacons;
+/**
+ *  Lookup table for beacons. Rebuilt on every beacons change.
+ */
+@property (strong) BLEBeaconsIndex *beaconsIndex;
+/**
+ *  Actions by unique identifier. Rebuilt on every beacons change.
+ */
+@property (strong) NSDictionary *actionsByIdentifier;
+/**
+ *  Reusable action instances by trigger, then by event type. Filled lazily, cleared on beacons, delegate or registered classes change.
+ */
+@property (strong) NSMapTable *resolvedActions;
 /**
  *  Location manager
  */
@@ -86,9 +124,25 @@ static NSMapTable *BLECustomActionClassess;
  */
 @property (strong) BLEBeaconsRangeBatch *rangeBatch;
 /**
- *  Delayed actions scheduler
+ *  Delayed leave events
+ */
+@property (strong) BLEDebounceEngine *leaveDebouncer;
+/**
+ *  Time based events for beacons in range
+ */
+@property (strong) BLEStaysTimerWheel *staysTimerWheel;
+/**
+ *  Monitored regions within system limit
+ */
+@property (strong) BLERegionPlanner *regionPlanner;
+/**
+ *  Ranging duty cycle
+ */
+@property (strong) BLERangingScheduler *rangingScheduler;
+/**
+ *  Filtered proximity of ranged beacons
  */
-@property (strong) BLEEventScheduler *eventScheduler;
+@property (strong) BLEProximityEstimator *proximityEstimator;
 /**
  *  CoreBluetooth
  */
@@ -96,10 +150,18 @@ static NSMapTable *BLECustomActionClassess;
 @end
 
 @implementation BLEKit {
+    NSSet *_beacons;
+    NSSet *_actions;
+    __weak id <BLEKitDelegate> _delegate;
+    NSUInteger _resolvedActionsGeneration;
     /**
      *  Retain zone if initialized with zone;
      */
     BLEZone *_zone;
+    /**
+     *  Regions are registered, re-register when zone is replaced
+     */
+    BOOL _lookingForBeacons;
 }
 
 + (void)initialize
@@ -114,12 +176,19 @@ static NSMapTable *BLECustomActionClassess;
         self.locationManager.delegate = self;
 
         self.defaultDelegate = [[BLEKitDefaultDelegate alloc] init];
-        self.eventScheduler = [[BLEEventScheduler alloc] init];
+        self.resolvedActions = [NSMapTable strongToStrongObjectsMapTable];
+        self.leaveDebouncer = [[BLEDebounceEngine alloc] init];
+        self.staysTimerWheel = [[BLEStaysTimerWheel alloc] initWithInterval:BLEStaysEventTimeInterval resolution:BLEStaysEventResolution];
+        self.staysTimerWheel.delegate = self;
+        self.regionPlanner = [[BLERegionPlanner alloc] initWithMaxRegions:BLERegionPlannerMaxRegions];
+        self.rangingScheduler = [[BLERangingScheduler alloc] initWithDelegate:self];
+        self.proximityEstimator = [[BLEProximityEstimator alloc] init];
         self.centralManager = [[CBCentralManager alloc] initWithDelegate:self queue:dispatch_get_main_queue()];
         
         [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handlePushNotificationAction:) name:UIApplicationDidFinishLaunchingNotification object:nil];
         [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handlePushNotificationAction:) name:BLEDidReceiveNotification object:nil];
-        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleBeaconTimerEvent:) name:BLEBeaconTimerFireNotification object:nil];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationStateDidChange:) name:UIApplicationDidEnterBackgroundNotification object:nil];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationStateDidChange:) name:UIApplicationWillEnterForegroundNotification object:nil];
     }
     return self;
 }
@@ -136,7 +205,8 @@ static NSMapTable *BLECustomActionClassess;
 {
     if (self = [self init]) {
         self.beacons = zone.beacons;
-        self->_zone = zone;        
+        self->_zone = zone;
+        [self reconcileStaysWithZone:zone];
     }
     return self;
 }
@@ -157,7 +227,12 @@ static NSMapTable *BLECustomActionClassess;
 
 - (instancetype) initWithZoneAtPath:(NSString *)path error:(NSError * __autoreleasing *)error
 {
-    if (self = [self initWithZoneData:[NSData dataWithContentsOfFile:path] error:error]) {
+    BLEZone *zone = [BLEZoneSnapshot zoneWithJSONAtPath:path error:error];
+    if (!zone) {
+        return nil;
+    }
+
+    if (self = [self initWithZone:zone]) {
         
     }
     return self;
@@ -178,18 +253,194 @@ static NSMapTable *BLECustomActionClassess;
     return [[BLEKit alloc] initWithZone:[BLEZone zoneWithJSONAtURL:url error:error]];
 }
 
++ (BLEKit *) kitWithZoneAtURL:(NSURL *)url completion:(void(^)(BLEKit *kit, NSError *error))completion
+{
+    NSParameterAssert(url);
+
+    // snapshot only, JSON is parsed in background
+    BOOL fresh = NO;
+    BLEZone *cachedZone = nil;
+    if (url.isFileURL) {
+        cachedZone = [BLEZoneSnapshot cachedZoneForJSONAtPath:url.path];
+        fresh = cachedZone != nil;
+    } else {
+        cachedZone = [[BLEZoneRepository sharedRepository] cachedZoneForURL:url fresh:&fresh];
+    }
+
+    BLEKit *kit = cachedZone ? [[BLEKit alloc] initWithZone:cachedZone] : [[BLEKit alloc] initWithBeacons:[NSSet set]];
+
+    if (fresh) {
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completion(kit, nil);
+            });
+        }
+        return kit;
+    }
+
+    __weak typeof(kit)kitWeak = kit;
+    void(^replaceZone)(BLEZone *zone, NSError *error) = ^(BLEZone *zone, NSError *error) {
+        BLEKit *kitStrong = kitWeak;
+        if (!kitStrong) {
+            return;
+        }
+        if (zone && zone != cachedZone) {
+            [kitStrong reloadWithZone:zone];
+        }
+        if (completion) {
+            completion(kitStrong, error);
+        }
+    };
+
+    if (url.isFileURL) {
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            NSError *error = nil;
+            BLEZone *zone = [BLEZoneSnapshot zoneWithJSONAtPath:url.path error:&error];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                replaceZone(zone, error);
+            });
+        });
+    } else {
+        [[BLEZoneRepository sharedRepository] revalidateZone:cachedZone fromURL:url completion:replaceZone];
+    }
+    return kit;
+}
+
+- (void) reloadWithZone:(BLEZone *)zone
+{
+    NSParameterAssert(zone);
+
+    BLEZoneDiff *diff = nil;
+    BOOL lookingForBeacons = NO;
+    @synchronized(self) {
+        diff = [[BLEZoneDiff alloc] initWithBeacons:_beacons zone:zone];
+        [diff apply];
+        self->_zone = zone;
+
+        if ([diff hasChanges]) {
+            NSSet *removedBeacons = diff.removedBeacons;
+            BLEKitPerformOnMainQueue(^{
+                for (BLEBeacon *beacon in removedBeacons) {
+                    [self.staysTimerWheel removeBeacon:beacon];
+                    [self.leaveDebouncer cancelForBeacon:beacon];
+                }
+            });
+            _beacons = diff.beacons;
+            [self beaconsDidChange];
+        }
+        [self reconcileStaysWithZone:zone];
+        lookingForBeacons = _lookingForBeacons;
+    }
+
+#ifdef DEBUG
+    NSLog(@"Reload zone %@: %@ added, %@ removed, %@ updated", zone.identifier, @(diff.addedBeacons.count), @(diff.removedBeacons.count), @(diff.updatedBeacons.count));
+#endif
+
+    if (lookingForBeacons) {
+        [self updateMonitoredRegions];
+    }
+}
+
 #pragma mark - Getters
 
+- (NSSet *)beacons
+{
+    @synchronized(self) {
+        return _beacons;
+    }
+}
+
+- (void)setBeacons:(NSSet *)beacons
+{
+    @synchronized(self) {
+        _beacons = [beacons copy];
+        BLEKitPerformOnMainQueue(^{
+            [self.staysTimerWheel removeAllBeacons];
+            [self.leaveDebouncer cancelAll];
+        });
+        [self beaconsDidChange];
+    }
+}
+
+/**
+ *  Expire stays of beacons not in loaded zone. Not for placeholder kit without zone,
+ *  stays persisted before launch are kept until real zone is loaded.
+ */
+- (void) reconcileStaysWithZone:(BLEZone *)zone
+{
+    @synchronized(self) {
+        if (zone && zone == _zone && _beacons.count > 0) {
+            [[BLEStaysStore sharedStore] reconcileWithBeaconIdentifiers:[_beacons valueForKey:@"identifier"]];
+        }
+    }
+}
+
+/**
+ *  Rebuild lookup tables for current beacons
+ */
+- (void) beaconsDidChange
+{
+    @synchronized(self) {
+        self.beaconsIndex = [[BLEBeaconsIndex alloc] initWithBeacons:_beacons];
+        [self.regionPlanner planRegionsForBeacons:_beacons];
+        [self.proximityEstimator removeFiltersExceptBeacons:_beacons];
+        [self indexActions];
+        [self invalidateResolvedActions];
+    }
+
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self updateRangingDemand];
+    });
+}
+
+- (id<BLEKitDelegate>)delegate
+{
+    @synchronized(self) {
+        return _delegate;
+    }
+}
+
+- (void)setDelegate:(id<BLEKitDelegate>)delegate
+{
+    @synchronized(self) {
+        _delegate = delegate;
+        [self invalidateResolvedActions];
+    }
+}
+
 - (NSSet *)actions
 {
-    // Collect all available actions
-    NSMutableSet *actions = [NSMutableSet setWithCapacity:1];
-    for (BLEBeacon *beacon in self.beacons) {
-        for (BLETrigger *trigger in beacon.triggers) {
-            [actions addObject:trigger.action];
+    @synchronized(self) {
+        return _actions;
+    }
+}
+
+/**
+ *  Collect all available actions and index them by unique identifier.
+ */
+- (void) indexActions
+{
+    @synchronized(self) {
+        NSMutableSet *actions = [NSMutableSet setWithCapacity:_beacons.count];
+        NSMutableDictionary *actionsByIdentifier = [NSMutableDictionary dictionaryWithCapacity:_beacons.count];
+        for (BLEBeacon *beacon in _beacons) {
+            for (BLETrigger *trigger in beacon.triggers) {
+                id <BLEAction> action = trigger.action;
+                if (!action) {
+                    continue;
+                }
+                [actions addObject:action];
+
+                NSString *uniqueIdentifier = action.uniqueIdentifier;
+                if (uniqueIdentifier) {
+                    NSSet *identifiedActions = actionsByIdentifier[uniqueIdentifier];
+                    actionsByIdentifier[uniqueIdentifier] = identifiedActions ? [identifiedActions setByAddingObject:action] : [NSSet setWithObject:action];
+                }
+            }
         }
+        _actions = actions.count > 0 ? [actions copy] : nil;
+        self.actionsByIdentifier = [actionsByIdentifier copy];
     }
-    return actions.count > 0 ? [actions copy] : nil;
 }
 
 - (BOOL) isInBackground
@@ -207,7 +458,10 @@ static NSMapTable *BLECustomActionClassess;
 + (void) registerClass:(Class <BLEAction>)actionClass forActionType:(NSString *)actionType;
 {
     NSParameterAssert(actionClass);
-    [BLECustomActionClassess setObject:actionClass forKey:actionType];
+    @synchronized(BLECustomActionClassess) {
+        [BLECustomActionClassess setObject:actionClass forKey:actionType];
+        BLECustomActionClassessGeneration++;
+    }
 }
 
 #pragma mark - Push Notifications
@@ -253,7 +507,7 @@ static NSMapTable *BLECustomActionClassess;
 
     for (id <BLEAction> generalAction in handledActions) {
         BLETrigger *trigger = generalAction.trigger;
-        id <BLEAction> determinedActionInstance = [self determineActionObjectForBeacon:trigger.beacon trigger:trigger eventType:[params[BLEActionEventTypeKey] integerValue]];
+        id <BLEAction> determinedActionInstance = [self actionForTrigger:trigger eventType:[params[BLEActionEventTypeKey] integerValue]];
 
         if ([determinedActionInstance respondsToSelector:@selector(handleURL:sourceApplication:annotation:)]) {
             if ([determinedActionInstance handleURL:url sourceApplication:sourceApplication annotation:annotation]) {
@@ -295,7 +549,7 @@ static NSMapTable *BLECustomActionClassess;
         NSSet *handledActions = [self searchForAction:notificationUserInfo[BLEActionUniqueIdentifierKey]];
         for (id <BLEAction> generalAction in handledActions) {
             BLETrigger *trigger = generalAction.trigger;
-            id <BLEAction> determinedActionInstance = [self determineActionObjectForBeacon:trigger.beacon trigger:trigger eventType:[notificationUserInfo[BLEActionEventTypeKey] integerValue]];
+            id <BLEAction> determinedActionInstance = [self actionForTrigger:trigger eventType:[notificationUserInfo[BLEActionEventTypeKey] integerValue]];
             if (determinedActionInstance) {
                 BLEEventType eventType = [notificationUserInfo[BLEActionEventTypeKey] integerValue];
                 
@@ -323,15 +577,12 @@ static NSMapTable *BLECustomActionClassess;
 - (void) stopLookingForBeacons
 {
     // Unregister only these regions monitored by BLEKit. It may be region registered outside BLEKit though (registered before of after BLEKit but we don't know that).
-    NSSet *monitoredRegionIdentifiers = [[SAMCache monitoredProximityCache] objectForKey:monitoredRegionIdentifiersKey];
-    NSSet *monitoredRegions = [self.locationManager.monitoredRegions filteredSetUsingPredicate:[NSPredicate predicateWithFormat:@"SELF.identifier IN %@",monitoredRegionIdentifiers]];
-    for (CLBeaconRegion *region in monitoredRegions) {
-        if ([self.locationManager.rangedRegions containsObject:region]) {
-            [self.locationManager stopRangingBeaconsInRegion:region];
-        }
-        [self.locationManager stopMonitoringForRegion:region];
+    [self stopMonitoringRegionsWithIdentifiers:[[BLEStateFile sharedStateFile] keysForType:BLEStateRecordTypeMonitoredRegion]];
+    [self.locationManager stopMonitoringSignificantLocationChanges];
+    [self.rangingScheduler removeAllRegions];
+    @synchronized(self) {
+        _lookingForBeacons = NO;
     }
-    [[SAMCache monitoredProximityCache] removeObjectForKey:monitoredRegionIdentifiersKey];
     
     for (BLEBeacon *beacon in self.beacons) {
         beacon.proximity = CLProximityUnknown;
@@ -360,47 +611,143 @@ static NSMapTable *BLECustomActionClassess;
         return NO;
     }
     
-    // Register new regions
-    NSMutableSet *monitoredRegionIdentifiers = [NSMutableSet setWithCapacity:self.beacons.count];
-    for (BLEBeacon *blebeacon in self.beacons) {
-        if (blebeacon.zone.identifier) {
-            
-            CLBeaconRegion *beaconRegion = nil;
-            
-            if (blebeacon.major && !blebeacon.minor) {
-                beaconRegion = [[CLBeaconRegion alloc] initWithProximityUUID:blebeacon.proximityUUID major:[blebeacon.major unsignedIntegerValue] identifier:blebeacon.identifier];
-            } else if (blebeacon.major && blebeacon.minor) {
-                beaconRegion = [[CLBeaconRegion alloc] initWithProximityUUID:blebeacon.proximityUUID major:[blebeacon.major unsignedIntegerValue] minor:[blebeacon.minor unsignedIntegerValue] identifier:blebeacon.identifier];
-            } else {
-                beaconRegion = [[CLBeaconRegion alloc] initWithProximityUUID:blebeacon.proximityUUID identifier:blebeacon.identifier];
-            }
-            beaconRegion.notifyOnEntry = YES;
-            beaconRegion.notifyOnExit = YES;
-            //FIXME: this perform didDetermineState every time phone go out of sleep
-            //When set to YES, the location manager sends beacon notifications when the user turns on the display and the device is already inside the region.
-            beaconRegion.notifyEntryStateOnDisplay = YES;
-            
-            [self.locationManager startMonitoringForRegion:beaconRegion];
-            [monitoredRegionIdentifiers addObject:beaconRegion.identifier];
+    // Regions monitored outside BLEKit count to the limit too
+    NSSet *monitoredRegionIdentifiers = [[BLEStateFile sharedStateFile] keysForType:BLEStateRecordTypeMonitoredRegion];
+    NSUInteger foreignRegionsCount = 0;
+    for (CLRegion *region in self.locationManager.monitoredRegions) {
+        if (![monitoredRegionIdentifiers containsObject:region.identifier]) {
+            foreignRegionsCount++;
         }
     }
+    self.regionPlanner.maxRegions = BLERegionPlannerMaxRegions > foreignRegionsCount ? BLERegionPlannerMaxRegions - foreignRegionsCount : 1;
+    self.regionPlanner.location = self.locationManager.location;
+    [self.regionPlanner planRegionsForBeacons:self.beacons];
+
+    @synchronized(self) {
+        _lookingForBeacons = YES;
+    }
+
+    [self updateMonitoredRegions];
     
-    // should I refresh observable regions?
-    // remove previously monitored regions but not monitored any more. JSON changed.
-    NSMutableSet *previouslyMonitoredRegionIdentifiers = [[[SAMCache monitoredProximityCache] objectForKey:monitoredRegionIdentifiersKey] mutableCopy];
+    return YES;
+}
+
+/**
+ *  Start monitoring planned regions not monitored yet, stop monitoring regions not planned any more.
+ *  Rotating plan is updated on significant location change.
+ */
+- (void) updateMonitoredRegions
+{
+    NSMutableSet *alreadyMonitoredIdentifiers = [NSMutableSet set];
+    for (CLRegion *region in self.locationManager.monitoredRegions) {
+        [alreadyMonitoredIdentifiers addObject:region.identifier];
+    }
+
+    NSArray *regions = self.regionPlanner.regions;
+    NSMutableSet *monitoredRegionIdentifiers = [NSMutableSet setWithCapacity:regions.count];
+    for (CLBeaconRegion *region in regions) {
+        if (![alreadyMonitoredIdentifiers containsObject:region.identifier]) {
+            [self.locationManager startMonitoringForRegion:region];
+        }
+        [monitoredRegionIdentifiers addObject:region.identifier];
+    }
+
+    // remove previously monitored regions but not monitored any more. JSON changed or regions rotated.
+    NSMutableSet *previouslyMonitoredRegionIdentifiers = [[[BLEStateFile sharedStateFile] keysForType:BLEStateRecordTypeMonitoredRegion] mutableCopy];
     [previouslyMonitoredRegionIdentifiers minusSet:monitoredRegionIdentifiers];
-    NSSet *regionsToRemove = [self.locationManager.monitoredRegions filteredSetUsingPredicate:[NSPredicate predicateWithFormat:@"SELF.identifier IN %@",previouslyMonitoredRegionIdentifiers]];
-    for (CLRegion *region in regionsToRemove) {
-        if ([self.locationManager.rangedRegions containsObject:region]) {
-            [self.locationManager stopMonitoringForRegion:region];
+    [self stopMonitoringRegionsWithIdentifiers:previouslyMonitoredRegionIdentifiers];
+
+    // save monitored regions
+    [[BLEStateFile sharedStateFile] setKeys:monitoredRegionIdentifiers forType:BLEStateRecordTypeMonitoredRegion];
+
+    if (self.regionPlanner.isRotating) {
+        [self.locationManager startMonitoringSignificantLocationChanges];
+    } else {
+        [self.locationManager stopMonitoringSignificantLocationChanges];
+    }
+}
+
+/**
+ *  Stop monitoring and ranging regions with given identifiers
+ *
+ *  @param identifiers Region identifiers
+ */
+- (void) stopMonitoringRegionsWithIdentifiers:(NSSet *)identifiers
+{
+    if (identifiers.count == 0) {
+        return;
+    }
+
+    for (CLRegion *region in self.locationManager.monitoredRegions) {
+        if (![identifiers containsObject:region.identifier]) {
+            continue;
+        }
+        [self.rangingScheduler removeRegionWithIdentifier:region.identifier];
+        if ([region isKindOfClass:[CLBeaconRegion class]] && [self.locationManager.rangedRegions containsObject:region]) {
+            [self.locationManager stopRangingBeaconsInRegion:(CLBeaconRegion *)region];
         }
         [self.locationManager stopMonitoringForRegion:region];
     }
 
-    // save monitored regions
-    [[SAMCache monitoredProximityCache] setObject:monitoredRegionIdentifiers forKey:monitoredRegionIdentifiersKey];
-    
-    return YES;
+    NSMutableSet *monitoredRegionIdentifiers = [[[BLEStateFile sharedStateFile] keysForType:BLEStateRecordTypeMonitoredRegion] mutableCopy];
+    [monitoredRegionIdentifiers minusSet:identifiers];
+    [[BLEStateFile sharedStateFile] setKeys:monitoredRegionIdentifiers forType:BLEStateRecordTypeMonitoredRegion];
+}
+
+/**
+ *  Drop resolved reusable actions, resolved again on next event.
+ */
+- (void) invalidateResolvedActions
+{
+    @synchronized(self) {
+        self.resolvedActions = [NSMapTable strongToStrongObjectsMapTable];
+        _resolvedActionsGeneration = BLECustomActionClassessGeneration;
+    }
+}
+
+/**
+ *  Action instance for trigger. Resolved on first use, reusable instance is cached for trigger and event type.
+ *
+ *  @param trigger   trigger
+ *  @param eventType event type
+ *
+ *  @return Action instance
+ */
+- (id <BLEAction>) actionForTrigger:(BLETrigger *)trigger eventType:(BLEEventType)eventType
+{
+    NSParameterAssert(trigger);
+
+    NSMapTable *resolvedActions = nil;
+    id <BLEAction> action = nil;
+    @synchronized(self) {
+        if (_resolvedActionsGeneration != BLECustomActionClassessGeneration) {
+            [self invalidateResolvedActions];
+        }
+        resolvedActions = self.resolvedActions;
+        action = [[resolvedActions objectForKey:trigger] objectForKey:@(eventType)];
+    }
+
+    if (action) {
+        return action;
+    }
+
+    // delegate is called without lock
+    action = [self determineActionObjectForBeacon:trigger.beacon trigger:trigger eventType:eventType];
+
+    if ([action respondsToSelector:@selector(isReusable)] && [action isReusable]) {
+        @synchronized(self) {
+            // don't fill cache invalidated meanwhile
+            if (self.resolvedActions == resolvedActions) {
+                NSMutableDictionary *actionsByEventType = [resolvedActions objectForKey:trigger];
+                if (!actionsByEventType) {
+                    actionsByEventType = [NSMutableDictionary dictionary];
+                    [resolvedActions setObject:actionsByEventType forKey:trigger];
+                }
+                actionsByEventType[@(eventType)] = action;
+            }
+        }
+    }
+    return action;
 }
 
 - (id <BLEAction>) determineActionObjectForBeacon:(BLEBeacon *)blebeacon trigger:(BLETrigger *)trigger eventType:(BLEEventType)eventType
@@ -411,7 +758,11 @@ static NSMapTable *BLECustomActionClassess;
     __strong __typeof(self->_delegate)delegate = self.delegate;
     
     // Check for registered class for action type
-    id <BLEAction> action = [[[BLECustomActionClassess objectForKey:trigger.action.type] alloc] initWithUniqueIdentifier:trigger.action.uniqueIdentifier andTrigger:trigger];
+    Class actionClass = nil;
+    @synchronized(BLECustomActionClassess) {
+        actionClass = [BLECustomActionClassess objectForKey:trigger.action.type];
+    }
+    id <BLEAction> action = [[actionClass alloc] initWithUniqueIdentifier:trigger.action.uniqueIdentifier andTrigger:trigger];
     
     // Check for delegate
     if (!action && delegate) {
@@ -431,12 +782,23 @@ static NSMapTable *BLECustomActionClassess;
     return action;
 }
 
-- (void) handleBeaconTimerEvent:(NSNotification *)notification
+#pragma mark - BLEStaysTimerWheelDelegate
+
+- (void)staysTimerWheel:(BLEStaysTimerWheel *)wheel didFireForBeacon:(BLEBeacon *)beacon
 {
-    NSParameterAssert(notification);
-    NSParameterAssert(notification.object);
-    
-    [self performAction:BLEEventTypeTimer beacon:notification.object];
+    NSParameterAssert(beacon);
+
+    [self performAction:BLEEventTypeTimer beacon:beacon];
+}
+
+/**
+ *  Start time based events for beacon if any trigger depends on time.
+ */
+- (void) startStaysEventsForBeacon:(BLEBeacon *)beacon
+{
+    if ([beacon triggersForEventType:BLEEventTypeTimer].count > 0) {
+        [self.staysTimerWheel addBeacon:beacon];
+    }
 }
 
 /**
@@ -450,6 +812,27 @@ static NSMapTable *BLECustomActionClassess;
  invalid data received.
  */
 - (void) processRegionState:(CLRegionState)state forRegion:(CLBeaconRegion *)region
+{
+    NSParameterAssert(region);
+
+    // search for beacons covered by region
+    NSArray *beacons = [self.regionPlanner beaconsForRegionIdentifier:region.identifier];
+    if (!beacons) {
+        BLEBeacon *foundBeacon = [self.beaconsIndex beaconForIdentifier:region.identifier];
+        beacons = foundBeacon ? @[foundBeacon] : @[];
+    }
+
+    for (BLEBeacon *beacon in beacons) {
+        if (![self.regionPlanner isMultiplexedBeacon:beacon]) {
+            [self processRegionState:state forBeacon:beacon];
+        } else if (state == CLRegionStateOutside && [self.regionPlanner setInside:NO forBeacon:beacon]) {
+            // enter to multiplexed beacon comes from ranging
+            [self processRegionState:state forBeacon:beacon];
+        }
+    }
+}
+
+- (void) processRegionState:(CLRegionState)state forBeacon:(BLEBeacon *)foundBeacon
 {
     if (self.paused) {
 #ifdef DEBUG
@@ -458,9 +841,6 @@ static NSMapTable *BLECustomActionClassess;
         return;
     }
     
-    NSParameterAssert(region);
-    // search for beacon and call actions
-    BLEBeacon *foundBeacon = [[self.beacons filteredSetUsingPredicate:[NSPredicate predicateWithFormat:@"identifier == %@",region.identifier]] anyObject];
     if (foundBeacon) {
         // search for trigger
         BLEEventType eventType = BLEEventTypeUnknown;
@@ -480,14 +860,12 @@ static NSMapTable *BLECustomActionClassess;
             // Schedule
             if (eventType == BLEEventTypeEnter) {
                 // if leave is scheduled then unschedule leave and do nothing
-                if ([self.eventScheduler isScheduledForBeacon:foundBeacon]) {
-                    [self.eventScheduler cancelForBeacon:foundBeacon];
-                } else {
+                if (![self.leaveDebouncer cancelForBeacon:foundBeacon]) {
                     // perform actual action
+                    [self.regionPlanner beaconSighted:foundBeacon];
                     
-                    //TODO: do it nicer
-                    SAMCache *staysCache = [[SAMCache alloc] initWithName:BLEBeaconStaysCacheName(foundBeacon)];
-                    [staysCache setObject:[NSDate date] forKey:foundBeacon.identifier];
+                    [[BLEStaysStore sharedStore] enterBeaconWithIdentifier:foundBeacon.identifier];
+                    [self startStaysEventsForBeacon:foundBeacon];
                     
                     if (foundBeacon.onEnterCallback) {
                         foundBeacon.onEnterCallback(foundBeacon);
@@ -497,13 +875,13 @@ static NSMapTable *BLECustomActionClassess;
             } else if (eventType == BLEEventTypeLeave) {
                 // schedule new leave cancelling old one (re-schedule)
                 __weak typeof(self)selfWeak = self;
-                [self.eventScheduler scheduleEventForBeacon:foundBeacon afterDelay:BLEDelayEventTimeInterval onTime:^(BLEBeacon *scheduledBeacon) {
+                [self.leaveDebouncer scheduleEventForBeacon:foundBeacon onTime:^(BLEBeacon *scheduledBeacon) {
                     // if beacon leave then assume that proximity is unknown (it's FAR FAr Far far away)
                     foundBeacon.proximity = CLProximityUnknown;
 
-                    // clear stays cache
-                    SAMCache *staysCache = [[SAMCache alloc] initWithName:BLEBeaconStaysCacheName(foundBeacon)];
-                    [staysCache removeObjectForKey:foundBeacon.identifier];
+                    // clear stays
+                    [[BLEStaysStore sharedStore] leaveBeaconWithIdentifier:foundBeacon.identifier];
+                    [selfWeak.staysTimerWheel removeBeacon:foundBeacon];
                     
                     if (scheduledBeacon.onExitCallback) {
                         scheduledBeacon.onExitCallback(foundBeacon);
@@ -536,22 +914,22 @@ static NSMapTable *BLECustomActionClassess;
     // Skip repeatable events in short period of time (due to hardware issues).
     // but for range event if defice is in state unable to determine for some time then guess that proximity is Far
     // This is performed only on change, but sometime there is much changes in short time - we should skip that and treat as disorder.
-    for (BLETrigger *matchTrigger in beacon.triggers) {
-        id <BLEAction, NSObject> action = [self determineActionObjectForBeacon:beacon trigger:matchTrigger eventType:eventType];
+    for (BLETrigger *matchTrigger in [beacon triggersForEventType:eventType]) {
+        id <BLEAction, NSObject> action = [self actionForTrigger:matchTrigger eventType:eventType];
 
         if (action) {
-            BOOL canPerformAction = [matchTrigger validateEventType:eventType];
+            BLETriggerValidationResult validation = [matchTrigger validateForEventType:eventType];
+            BOOL canPerformAction = validation.eventMatched;
             if (canPerformAction && [action respondsToSelector:@selector(canPerformBeaconAction:forState:eventType:)]) {
                 canPerformAction = [action canPerformBeaconAction:matchTrigger forState:self.currentActionState eventType:eventType];
             }
-            
 
-            canPerformAction = canPerformAction && [matchTrigger validateConditionsWithoutOccurrency:eventType];
+            canPerformAction = canPerformAction && validation.parametersMatched;
             if (canPerformAction) {
-                [[SAMCache actionCache] incrementUsageNumberValueForAction:action];
+                [[BLEOccurrenceStore sharedStore] setValue:validation.occurrence atSlot:[matchTrigger occurrenceSlot]];
             }
             
-            canPerformAction = canPerformAction && [matchTrigger validateConditionsWithOccurrence:eventType];
+            canPerformAction = canPerformAction && validation.occurrenceMatched;
             
             if (canPerformAction && beacon.onPerformActionCallback) {
                 canPerformAction = beacon.onPerformActionCallback(beacon, action, eventType, NO);
@@ -582,41 +960,55 @@ static NSMapTable *BLECustomActionClassess;
 {
     NSParameterAssert(actionIdentifier);
 
-    NSSet *actions = [self.actions objectsPassingTest:^BOOL(id obj, BOOL *stop) {
-        if (![obj conformsToProtocol:@protocol(BLEAction)])
-            return NO;
-
-        id <BLEAction> action = obj;
-        if ([action.uniqueIdentifier isEqualToString:actionIdentifier]) {
-            return YES;
-        }
-        return NO;
-    }];
-
-    return actions;
+    return self.actionsByIdentifier[actionIdentifier] ?: [NSSet set];
 }
 
 #pragma mark - CLLocationManagerDelegate
 
 /**
- *  Not used. For debugging purposed only
+ *  Significant location change, rotate monitored regions
  */
-#ifdef DEBUG
+- (void)locationManager:(CLLocationManager *)manager didUpdateLocations:(NSArray *)locations
+{
+    BOOL lookingForBeacons = NO;
+    @synchronized(self) {
+        lookingForBeacons = _lookingForBeacons;
+    }
+    if (!lookingForBeacons || !self.regionPlanner.isRotating) {
+        return;
+    }
+
+    self.regionPlanner.location = [locations lastObject];
+    if ([self.regionPlanner planRegionsForBeacons:self.beacons]) {
+        [self updateMonitoredRegions];
+    }
+}
+
 - (void)locationManager:(CLLocationManager *)manager didDetermineState:(CLRegionState)state forRegion:(CLBeaconRegion *)region
 {
+    if (![region isKindOfClass:[CLBeaconRegion class]]) {
+        return;
+    }
+
+    [self.rangingScheduler setDemanded:[self isRangingDemandedForRegionIdentifier:region.identifier] forRegionIdentifier:region.identifier];
+    [self.rangingScheduler setInside:state == CLRegionStateInside forRegion:region];
+
     if (state == CLRegionStateInside) {
-        // Trick to start count stays even if application was already in area but lastEnter was not in the record
-        BLEBeacon *foundBeacon = [[self.beacons filteredSetUsingPredicate:[NSPredicate predicateWithFormat:@"identifier == %@",region.identifier]] anyObject];
-        {
-            SAMCache *staysCache = [[SAMCache alloc] initWithName:BLEBeaconStaysCacheName(foundBeacon)];
-            NSDate *lastEnter = [staysCache objectForKey:foundBeacon.identifier];
-            if (!lastEnter) {
-                [staysCache setObject:[NSDate date] forKey:foundBeacon.identifier];
+        for (BLEBeacon *foundBeacon in [self.regionPlanner beaconsForRegionIdentifier:region.identifier]) {
+#ifdef DEBUG
+            // For debugging purposed only
+            // Trick to start count stays even if application was already in area but lastEnter was not in the record
+            if (![self.regionPlanner isMultiplexedBeacon:foundBeacon]) {
+                [[BLEStaysStore sharedStore] enterBeaconIfNeededWithIdentifier:foundBeacon.identifier];
+            }
+#endif
+            // enter persisted before relaunch, no enter event will come while inside
+            if ([[BLEStaysStore sharedStore] isEnteredBeaconWithIdentifier:foundBeacon.identifier]) {
+                [self startStaysEventsForBeacon:foundBeacon];
             }
         }
     }
 }
-#endif
 
 /**
  *  Gather ranged data and every period of time, process gathered data and clear batch
@@ -626,7 +1018,8 @@ static NSMapTable *BLECustomActionClassess;
     if (rangedBeacons.count == 0)
         return;
     
-    if (self.isInBackground)
+    // multiplexed regions are resolved to beacons by ranging, in background too
+    if (self.isInBackground && ![self.regionPlanner isMultiplexedRegionIdentifier:region.identifier])
         return;
 
     if (!self.rangeBatch) {
@@ -642,6 +1035,8 @@ static NSMapTable *BLECustomActionClassess;
 - (void)locationManager:(CLLocationManager *)manager didEnterRegion:(CLBeaconRegion *)region
 {
     UIBackgroundTaskIdentifier backgroundTaskIdentifier = [[UIApplication sharedApplication] beginBackgroundTaskWithExpirationHandler:nil];
+    [self.rangingScheduler setDemanded:[self isRangingDemandedForRegionIdentifier:region.identifier] forRegionIdentifier:region.identifier];
+    [self.rangingScheduler setInside:YES forRegion:region];
     [self processRegionState:CLRegionStateInside forRegion:region];
     if (backgroundTaskIdentifier != UIBackgroundTaskInvalid) {
         [[UIApplication sharedApplication] endBackgroundTask:backgroundTaskIdentifier];
@@ -653,20 +1048,16 @@ static NSMapTable *BLECustomActionClassess;
  */
 - (void)locationManager:(CLLocationManager *)manager didExitRegion:(CLBeaconRegion *)region
 {
+    [self.rangingScheduler setInside:NO forRegion:region];
     [self processRegionState:CLRegionStateOutside forRegion:region];
 }
 
-- (void) startRangingBeaconsInRegion:(CLBeaconRegion *)region
-{
-    [self.locationManager startRangingBeaconsInRegion:region];
-}
-
 /**
- * iOS correct proximity with the delay especially for multiple beacons available, so added this delay to let adjust at the start.
+ *  Ranging starts when state is determined, if region is inside and ranging is demanded.
  */
 - (void)locationManager:(CLLocationManager *)manager didStartMonitoringForRegion:(CLBeaconRegion *)region
 {
-    [self performSelector:@selector(startRangingBeaconsInRegion:) withObject:region afterDelay:2];
+    [manager requestStateForRegion:region];
 }
 
 - (void)locationManager:(CLLocationManager *)manager rangingBeaconsDidFailForRegion:(CLBeaconRegion *)region withError:(NSError *)error
@@ -674,6 +1065,95 @@ static NSMapTable *BLECustomActionClassess;
     NSLog(@"rangingBeaconsDidFailForRegion, reason: %@", error);
 }
 
+#pragma mark - Ranging
+
+/**
+ *  Region is ranged if events of its beacons come from ranging: range triggers, proximity callback or multiplexed region.
+ */
+- (BOOL) isRangingDemandedForRegionIdentifier:(NSString *)identifier
+{
+    if ([self.regionPlanner isMultiplexedRegionIdentifier:identifier]) {
+        return YES;
+    }
+
+    // ranged beacons are not processed in background
+    if (self.isInBackground) {
+        return NO;
+    }
+
+    NSArray *beacons = [self.regionPlanner beaconsForRegionIdentifier:identifier];
+    if (!beacons) {
+        BLEBeacon *foundBeacon = [self.beaconsIndex beaconForIdentifier:identifier];
+        beacons = foundBeacon ? @[foundBeacon] : @[];
+    }
+    for (BLEBeacon *beacon in beacons) {
+        if (beacon.onChangeProximityCallback || [beacon triggersForEventType:BLEEventTypeRange].count > 0) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (void) updateRangingDemand
+{
+    for (CLBeaconRegion *region in self.regionPlanner.regions) {
+        [self.rangingScheduler setDemanded:[self isRangingDemandedForRegionIdentifier:region.identifier] forRegionIdentifier:region.identifier];
+    }
+}
+
+- (void) applicationStateDidChange:(NSNotification *)notification
+{
+    [self updateRangingDemand];
+}
+
+- (NSTimeInterval)rangingTimeInterval
+{
+    return self.rangingScheduler.rangingTimeInterval;
+}
+
+#pragma mark - Leave delay
+
+- (NSTimeInterval)leaveDelay
+{
+    return self.leaveDebouncer.defaultDelay;
+}
+
+- (void)setLeaveDelay:(NSTimeInterval)leaveDelay
+{
+    BLEKitPerformOnMainQueue(^{
+        self.leaveDebouncer.defaultDelay = MAX(0, leaveDelay);
+    });
+}
+
+- (void) setLeaveDelay:(NSTimeInterval)delay forZone:(BLEZone *)zone
+{
+    NSParameterAssert(zone.identifier);
+    NSString *identifier = zone.identifier;
+    BLEKitPerformOnMainQueue(^{
+        [self.leaveDebouncer setDelay:delay forZoneIdentifier:identifier];
+    });
+}
+
+- (void) setLeaveDelay:(NSTimeInterval)delay forBeacon:(BLEBeacon *)beacon
+{
+    NSParameterAssert(beacon);
+    BLEKitPerformOnMainQueue(^{
+        [self.leaveDebouncer setDelay:delay forBeacon:beacon];
+    });
+}
+
+#pragma mark - BLERangingSchedulerDelegate
+
+- (void)rangingScheduler:(BLERangingScheduler *)scheduler startRangingBeaconsInRegion:(CLBeaconRegion *)region
+{
+    [self.locationManager startRangingBeaconsInRegion:region];
+}
+
+- (void)rangingScheduler:(BLERangingScheduler *)scheduler stopRangingBeaconsInRegion:(CLBeaconRegion *)region
+{
+    [self.locationManager stopRangingBeaconsInRegion:region];
+}
+
 #pragma mark - CBCentralManagerDelegate
 
 /**
@@ -690,7 +1170,7 @@ static NSMapTable *BLECustomActionClassess;
 
 #pragma mark - BLEBeaconsRangeBatchDelegate
 
-- (void)processRangeBatch:(BLEBeaconsRangeBatch *)batch beacons:(NSArray *)rangedBeacons
+- (void)processRangeBatch:(BLEBeaconsRangeBatch *)batch samples:(const BLERangeSample *)samples count:(NSUInteger)samplesCount regionIdentifier:(NSString *)regionIdentifier
 {
     if (self.paused) {
 #ifdef DEBUG
@@ -699,34 +1179,86 @@ static NSMapTable *BLECustomActionClassess;
         return;
     }
 
-    NSArray *knownRangedBeacons = [rangedBeacons filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"accuracy > 0"]];
-    NSArray *rangedBeaconsSorted = [knownRangedBeacons sortedArrayUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"accuracy" ascending:YES],[NSSortDescriptor sortDescriptorWithKey:@"rssi" ascending:YES]]];
-    
-    if (rangedBeaconsSorted.count > 0) {
-        for (BLEBeacon *bleBeacon in self.beacons) {
-            CLBeacon *rangedBeacon = rangedBeaconsSorted[0];
-            if ([rangedBeacon.blekit_identifier hasPrefix:bleBeacon.identifier]) {
-                bleBeacon.accuracy = rangedBeacon.accuracy;
-                bleBeacon.rssi = rangedBeacon.rssi;
-                // Guess the proximty based on accuracy value
-                if (rangedBeacon.proximity != CLProximityUnknown && rangedBeacon.accuracy > 0) {
-                    CLProximity guessedProximity = CLProximityUnknown;
-                    if (rangedBeacon.accuracy < 0.5) {
-                        guessedProximity = CLProximityImmediate;
-                    } else if (rangedBeacon.accuracy <= 3.0) {
-                        guessedProximity = CLProximityNear;
-                    } else {
-                        guessedProximity = CLProximityFar;
-                    }
-                    
-                    if (bleBeacon.proximity != guessedProximity) {
-                        bleBeacon.proximity = guessedProximity;
-                        [self beaconProximityDidChange:bleBeacon];
-                    }
+    BLEBeaconsIndex *beaconsIndex = self.beaconsIndex;
+    NSUInteger beaconsCount = beaconsIndex.count;
+    if (beaconsCount == 0 || samplesCount == 0) {
+        return;
+    }
+
+    // Nearest sample (by accuracy, then rssi) for every configured beacon, grouped by packed key in a single pass.
+    NSInteger *nearestSamples = malloc(beaconsCount * sizeof(NSInteger));
+    for (NSUInteger slot = 0; slot < beaconsCount; slot++) {
+        nearestSamples[slot] = NSNotFound;
+    }
+
+    // beacons ranged in window, also with unknown accuracy
+    NSMutableArray *rangedBeacons = [NSMutableArray array];
+    BOOL multiplexedRegion = [self.regionPlanner isMultiplexedRegionIdentifier:regionIdentifier];
+
+    NSUInteger slots[BLEBeaconsIndexMaxMatches];
+    for (NSUInteger sampleIndex = 0; sampleIndex < samplesCount; sampleIndex++) {
+        const BLERangeSample *sample = &samples[sampleIndex];
+        NSUInteger slotsCount = [beaconsIndex getSlots:slots matchingKey:sample->key];
+        if (multiplexedRegion) {
+            for (NSUInteger i = 0; i < slotsCount; i++) {
+                [rangedBeacons addObject:[beaconsIndex beaconAtSlot:slots[i]]];
+            }
+        }
+
+        if (sample->accuracy <= 0) {
+            continue;
+        }
+
+        for (NSUInteger i = 0; i < slotsCount; i++) {
+            NSInteger nearestIndex = nearestSamples[slots[i]];
+            if (nearestIndex == NSNotFound) {
+                nearestSamples[slots[i]] = sampleIndex;
+            } else {
+                const BLERangeSample *nearestSample = &samples[nearestIndex];
+                if (sample->accuracy < nearestSample->accuracy || (sample->accuracy == nearestSample->accuracy && sample->rssi < nearestSample->rssi)) {
+                    nearestSamples[slots[i]] = sampleIndex;
                 }
             }
         }
     }
+
+    for (NSUInteger slot = 0; slot < beaconsCount; slot++) {
+        if (nearestSamples[slot] == NSNotFound) {
+            continue;
+        }
+
+        BLEBeacon *bleBeacon = [beaconsIndex beaconAtSlot:slot];
+        const BLERangeSample *sample = &samples[nearestSamples[slot]];
+        [self.regionPlanner beaconSighted:bleBeacon];
+        if ([self.regionPlanner isMultiplexedBeacon:bleBeacon] && [self.regionPlanner setInside:YES forBeacon:bleBeacon]) {
+            [self.rangingScheduler activityInRegionWithIdentifier:[self.regionPlanner regionIdentifierForBeacon:bleBeacon]];
+            [self processRegionState:CLRegionStateInside forBeacon:bleBeacon];
+        }
+
+        bleBeacon.accuracy = sample->accuracy;
+        bleBeacon.rssi = sample->rssi;
+        // Guess the proximty based on filtered accuracy value
+        if (sample->proximity != CLProximityUnknown) {
+            CLLocationAccuracy filteredAccuracy = 0;
+            CLProximity guessedProximity = [self.proximityEstimator proximityForBeacon:bleBeacon accuracy:sample->accuracy time:sample->timestamp filteredAccuracy:&filteredAccuracy];
+            bleBeacon.accuracy = filteredAccuracy;
+
+            if (bleBeacon.proximity != guessedProximity) {
+                [self.rangingScheduler activityInRegionWithIdentifier:[self.regionPlanner regionIdentifierForBeacon:bleBeacon]];
+                bleBeacon.proximity = guessedProximity;
+                [self beaconProximityDidChange:bleBeacon];
+            }
+        }
+    }
+
+    free(nearestSamples);
+
+    // multiplexed beacons have no region exit of their own while other beacons of region are in range
+    if (multiplexedRegion) {
+        for (BLEBeacon *leftBeacon in [self.regionPlanner rangingWindowInRegionWithIdentifier:regionIdentifier rangedBeacons:rangedBeacons]) {
+            [self processRegionState:CLRegionStateOutside forBeacon:leftBeacon];
+        }
+    }
 }
 
 @end
@@ -33,6 +33,28 @@
 @protocol BLEAction;
 @class BLEAction, BLEBeacon;
 
+/**
+ *  Result of single validation pass of trigger conditions
+ */
+typedef struct {
+    /**
+     *  All conditions are valid for event type
+     */
+    BOOL eventMatched;
+    /**
+     *  All conditions parameters are valid, occurrence is not counted
+     */
+    BOOL parametersMatched;
+    /**
+     *  All conditions parameters are valid for @c occurrence
+     */
+    BOOL occurrenceMatched;
+    /**
+     *  Occurrence if counted (current occurrence + 1)
+     */
+    NSInteger occurrence;
+} BLETriggerValidationResult;
+
 @interface BLETrigger : NSObject <NSSecureCoding>
 
 /**
@@ -70,14 +92,25 @@
  */
 - (instancetype) initWithBeacon:(BLEBeacon *)blebeacon;
 
+/**
+ *  Validate conditions in a single pass. Each condition is evaluated once,
+ *  and once again only if it depends on occurrence.
+ *
+ *  @param eventType event type
+ *
+ *  @return Validation result
+ */
+- (BLETriggerValidationResult) validateForEventType:(BLEEventType)eventType;
+
 /**
  *  Validate trigger conditions and count as occurrence
  *
  *  @param eventType event type
  *
- *  @return YES if valid for all conditions
+ *  @return YES if valid for all conditions with occurrence about to be counted
+ *  @deprecated Use validateForEventType: and check occurrenceMatched
  */
-- (BOOL) validateConditionsWithOccurrence:(BLEEventType)eventType;
+- (BOOL) validateConditionsWithOccurrence:(BLEEventType)eventType DEPRECATED_MSG_ATTRIBUTE("Use validateForEventType:");
 
 /**
  *  Validate trigger conditions and don't count as occurrence
@@ -85,8 +118,9 @@
  *  @param eventType event type
  *
  *  @return YES if valid for all conditions
+ *  @deprecated Use validateForEventType: and check parametersMatched
  */
-- (BOOL) validateConditionsWithoutOccurrency:(BLEEventType)eventType;
+- (BOOL) validateConditionsWithoutOccurrency:(BLEEventType)eventType DEPRECATED_MSG_ATTRIBUTE("Use validateForEventType:");
 
 /**
  *  Validate event type
@@ -94,7 +128,8 @@
  *  @param eventType event type
  *
  *  @return YES if valid for given event type
+ *  @deprecated Use validateForEventType: and check eventMatched
  */
-- (BOOL) validateEventType:(BLEEventType)eventType;
+- (BOOL) validateEventType:(BLEEventType)eventType DEPRECATED_MSG_ATTRIBUTE("Use validateForEventType:");
 
 @end
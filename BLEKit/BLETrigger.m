@@ -30,8 +30,12 @@
 
 #import "BLEKitPrivate.h"
 #import "UNCodingUtil.h"
+#import "BLEOccurrenceStore.h"
 
-@implementation BLETrigger
+@implementation BLETrigger {
+    NSUInteger _occurrenceSlot;
+    BOOL _hasOccurrenceSlot;
+}
 
 - (instancetype) initWithBeacon:(BLEBeacon *)blebeacon
 {
@@ -64,42 +68,93 @@
 
     if (dictionary[@"conditions"]) {
         NSArray *array = dictionary[@"conditions"];
-        NSMutableSet *set = [NSMutableSet setWithCapacity:array.count];
+        NSMutableOrderedSet *conditions = [NSMutableOrderedSet orderedSetWithCapacity:array.count];
         
         for (NSDictionary *conditionDictionary in array) {
             BLECondition *condition = [[BLECondition alloc] initWithTrigger:self];
             [condition updatePropertiesFromDictionary:conditionDictionary];
-            [set addObject:condition];
+            [conditions addObject:condition];
         }
-        self->_conditions = [set copy];
+        self->_conditions = [conditions copy];
     }
 }
 
-- (BOOL) validateConditionsWithOccurrence:(BLEEventType)eventType
+- (BLEEventType) eventType
 {
+    BLEEventType eventType = BLEEventTypeUnknown;
     for (BLECondition *condition in self.conditions) {
-        if (![condition validateForEventType:eventType] || ![condition validateForParameters:YES])
-            return NO;
+        if (eventType != BLEEventTypeUnknown && condition.eventType != eventType) {
+            return BLEEventTypeUnknown;
+        }
+        eventType = condition.eventType;
     }
-    return self.conditions.count > 0 ? YES : NO;
+    return eventType;
 }
 
-- (BOOL) validateConditionsWithoutOccurrency:(BLEEventType)eventType
+- (void)setAction:(id<BLEAction>)action
 {
-    for (BLECondition *condition in self.conditions) {
-        if (![condition validateForEventType:eventType] || ![condition validateForParameters:NO])
-            return NO;
+    _action = action;
+    _hasOccurrenceSlot = NO;
+}
+
+- (NSUInteger) occurrenceSlot
+{
+    if (!_hasOccurrenceSlot) {
+        __strong __typeof(self.beacon)beaconStrong = self.beacon;
+        _occurrenceSlot = [[BLEOccurrenceStore sharedStore] slotForKey:BLECacheActionIdentifierFormat(self.action, beaconStrong)];
+        _hasOccurrenceSlot = YES;
     }
-    return self.conditions.count > 0 ? YES : NO;
+    return _occurrenceSlot;
 }
 
-- (BOOL) validateEventType:(BLEEventType)eventType
+- (BLETriggerValidationResult) validateForEventType:(BLEEventType)eventType
 {
-    for (BLECondition *condition in self.conditions) {
+    BLETriggerValidationResult result = {NO, NO, NO, 0};
+
+    NSOrderedSet *conditions = self.conditions;
+    if (conditions.count == 0) {
+        return result;
+    }
+
+    for (BLECondition *condition in conditions) {
         if (![condition validateForEventType:eventType])
-            return NO;
+            return result;
     }
-    return self.conditions.count > 0 ? YES : NO;
+    result.eventMatched = YES;
+
+    NSInteger occurrence = (NSInteger)[[BLEOccurrenceStore sharedStore] valueAtSlot:[self occurrenceSlot]];
+    result.occurrence = occurrence + 1;
+
+    BOOL occurrenceMatched = YES;
+    for (BLECondition *condition in conditions) {
+        BOOL parametersMatched = [condition validateForParameters:NO occurrence:occurrence];
+        if (!parametersMatched) {
+            return result;
+        }
+
+        if (occurrenceMatched) {
+            // evaluate again only if result depends on occurrence
+            occurrenceMatched = [condition usesOccurrence] ? [condition validateForParameters:YES occurrence:result.occurrence] : parametersMatched;
+        }
+    }
+    result.parametersMatched = YES;
+    result.occurrenceMatched = occurrenceMatched;
+    return result;
+}
+
+- (BOOL) validateConditionsWithOccurrence:(BLEEventType)eventType
+{
+    return [self validateForEventType:eventType].occurrenceMatched;
+}
+
+- (BOOL) validateConditionsWithoutOccurrency:(BLEEventType)eventType
+{
+    return [self validateForEventType:eventType].parametersMatched;
+}
+
+- (BOOL) validateEventType:(BLEEventType)eventType
+{
+    return [self validateForEventType:eventType].eventMatched;
 }
 
 #pragma mark - NSSecureCoding
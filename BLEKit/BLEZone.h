@@ -101,7 +101,8 @@
 
 /** Fetch zone */
 /**
- *  Fetch zone from URL. Synchronous.
+ *  Fetch zone from URL. Synchronous, blocks until request is finished.
+ *  Use fetchAsyncZoneFromURL:completion: or fetchCachedZoneFromURL:completion: on main thread.
  *
  *  @param zoneURL URL
  *
@@ -109,11 +110,22 @@
  */
 + (BLEZone *) fetchZoneFromURL:(NSURL *)zoneURL;
 /**
- *  Fetch zone from URL. Asynchronous.
+ *  Fetch zone from URL. Asynchronous, zone is parsed in background.
  *
  *  @param zoneURL    URL
- *  @param completion completion block.
+ *  @param completion completion block, called on main queue.
  */
 + (void) fetchAsyncZoneFromURL:(NSURL *)zoneURL completion:(void(^)(BLEZone *zone, NSError *error))completion;
+/**
+ *  Fetch zone from URL through local cache. Asynchronous.
+ *
+ *  Cached zone is returned without request while within its time to life. Expired zone is revalidated
+ *  with conditional request (ETag, Last-Modified) and parsed again only if content changed.
+ *  If request fails, expired cached zone is returned along with error.
+ *
+ *  @param zoneURL    URL
+ *  @param completion completion block, called on main queue.
+ */
++ (void) fetchCachedZoneFromURL:(NSURL *)zoneURL completion:(void(^)(BLEZone *zone, NSError *error))completion;
 
 @end
@@ -31,6 +31,8 @@
 #import "UNCodingUtil.h"
 #import "UNMutableURLRequest.h"
 #import "UNURLConnection.h"
+#import "BLEZoneParser.h"
+#import "BLEZoneRepository.h"
 
 #import "BLEKitPrivate.h"
 
@@ -49,31 +51,32 @@
 - (instancetype) initWithJSON:(NSData *)jsonData error:(NSError * __autoreleasing *)error
 {
     if (self = [self init]) {
-        NSDictionary *zoneDictionary = [NSJSONSerialization JSONObjectWithData:jsonData options:0 error:error];
-        if (!zoneDictionary) {
+        BLEZoneParser *parser = [[BLEZoneParser alloc] initWithData:jsonData];
+        if (![parser parseIntoZone:self error:error]) {
             return nil;
         }
-        
-        [self updatePropertiesFromDictionary:zoneDictionary];
     }
     return self;
 }
 
 - (instancetype) initWithJSONAtPath:(NSString *)jsonPath error:(NSError * __autoreleasing *)error
 {
-    NSData *jsonData = [NSData dataWithContentsOfFile:jsonPath options:NSDataReadingUncached error:error];
-    if (!jsonData) {
-        return nil;
-    }
-    
-    if (self = [self initWithJSON:jsonData error:error]) {
-        // stuff
+    if (self = [self init]) {
+        // read in chunks, file is never loaded at once
+        BLEZoneParser *parser = [[BLEZoneParser alloc] initWithInputStream:[NSInputStream inputStreamWithFileAtPath:jsonPath]];
+        if (![parser parseIntoZone:self error:error]) {
+            return nil;
+        }
     }
     return self;
 }
 
 - (instancetype) initWithJSONAtURL:(NSURL *)url error:(NSError * __autoreleasing *)error
 {
+    if (url.isFileURL) {
+        return [self initWithJSONAtPath:url.path error:error];
+    }
+
     NSData *jsonData = [NSData dataWithContentsOfURL:url options:NSDataReadingUncached error:error];
     if (!jsonData) {
         return nil;
@@ -87,7 +90,7 @@
 
 + (BLEZone *) zoneWithJSONAtURL:(NSURL *)url error:(NSError * __autoreleasing *)error
 {
-    return [[BLEZone alloc] initWithJSON:[NSData dataWithContentsOfURL:url] error:error];
+    return [[BLEZone alloc] initWithJSONAtURL:url error:error];
 }
 
 + (BLEZone *) zoneWithJSONAtPath:(NSString *)jsonPath error:(NSError * __autoreleasing *)error
@@ -147,7 +150,6 @@
 {
     NSParameterAssert(zoneURL);
 
-    __block BLEZone *zone = nil;
     UNMutableURLRequest *request = [[UNMutableURLRequest alloc] initWithGetURL:zoneURL parameters:nil];
     UNURLConnection *connection = [UNURLConnection connectionWithRequest:request completion:^(NSHTTPURLResponse *response, NSData *responseData, NSError *errorRequest) {
         if (errorRequest || responseData.length == 0) {
@@ -156,23 +158,46 @@
             }
             return;
         }
-        
-        NSError *error = nil;
-        zone = [[self class] zoneWithJSON:responseData error:&error];
-        if (completion) {
-            completion(zone, error);
-        }
+
+        // parse in background, connection calls back on main thread
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            NSError *error = nil;
+            BLEZone *zone = [[self class] zoneWithJSON:responseData error:&error];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if (completion) {
+                    completion(zone, error);
+                }
+            });
+        });
     }];
     [connection start];
 }
 
++ (void) fetchCachedZoneFromURL:(NSURL *)zoneURL completion:(void(^)(BLEZone *zone, NSError *error))completion
+{
+    NSParameterAssert(zoneURL);
+
+    [[BLEZoneRepository sharedRepository] fetchZoneFromURL:zoneURL completion:completion];
+}
+
 + (BLEZone *) fetchZoneFromURL:(NSURL *)zoneURL
 {
     NSParameterAssert(zoneURL);
 
     __block BLEZone *returnZone = nil;
-    __block BOOL finished = NO;
 
+    if (![NSThread isMainThread]) {
+        // completion is called on main queue
+        dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+        [BLEZone fetchAsyncZoneFromURL:zoneURL completion:^(BLEZone *zone, NSError *error) {
+            returnZone = zone;
+            dispatch_semaphore_signal(semaphore);
+        }];
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+        return returnZone;
+    }
+
+    __block BOOL finished = NO;
     [BLEZone fetchAsyncZoneFromURL:zoneURL completion:^(BLEZone *zone, NSError *error) {
         returnZone = zone;
         finished = YES;
@@ -26,52 +26,47 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+
 #import <Foundation/Foundation.h>
-#import "BLEKit.h"
+#import <CoreLocation/CoreLocation.h>
 
-//@class BLEEventScheduler;
-//
-//@protocol BLEEventSchedulerDelegate <NSObject>
-//- (void) bleEventScheduler:(BLEEventScheduler*) scheduler perform:(NSInvocation *)invocation;
-//@end
+#import "BLEBeaconKey.h"
 
 /**
- *  Schedule events for later execution. Used to delay 'leave' action.
+ *  Immutable beacon identity. Hash is computed once and identifier string is built once on first use,
+ *  so identity is cheap to use as dictionary key and to compare.
  */
-@interface BLEEventScheduler : NSObject
-
-@property (assign) UIBackgroundTaskIdentifier backgroundTaskIdentifier;
-@property (strong) NSMutableDictionary *timers;
+@interface BLEBeaconIdentity : NSObject <NSCopying>
 
 /**
- *  Schedule event for later.
- *
- *  @param beacon   Beacon
- *  @param delay    Delay value in seconds
- *  @param callback On time callback block
+ *  Packed identity
  */
-- (void) scheduleEventForBeacon:(BLEBeacon *)beacon afterDelay:(NSTimeInterval)delay onTime:(void(^)(BLEBeacon *beacon))callback;
-
-/// Cancel scheduled event for given beacon
-/// @return YES if cancelled, NO if not found (not cancelled)
+@property (assign, readonly) BLEBeaconKey key;
+/**
+ *  Identifier string UUID+major+minor, built lazily
+ */
+@property (strong, readonly) NSString *stringValue;
 
 /**
- *  Cancel scheduled event
+ *  Identity for key
  *
- *  @param beacon beacon
+ *  @param key Beacon key
  *
- *  @return YES if canelled.
+ *  @return Identity
  */
-- (BOOL) cancelForBeacon:(BLEBeacon *)beacon;
++ (instancetype) identityWithKey:(BLEBeaconKey)key;
 
 /**
- *  Check if beacon have scheduled event
+ *  Identity of configured or ranged beacon, doesn't format any string
  *
- *  @param beacon beacon
+ *  @param beacon Beacon
  *
- *  @return YES if event is scheduled for beacon
+ *  @return Identity
  */
-- (BOOL) isScheduledForBeacon:(BLEBeacon *)beacon;
++ (instancetype) identityForBeacon:(CLBeacon *)beacon;
+
+- (instancetype) initWithKey:(BLEBeaconKey)key;
 
+- (BOOL) isEqualToIdentity:(BLEBeaconIdentity *)identity;
 
 @end
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEBeaconIdentity.h"
+
+@implementation BLEBeaconIdentity {
+    NSUInteger _hash;
+    NSString *_stringValue;
+}
+
++ (instancetype) identityWithKey:(BLEBeaconKey)key
+{
+    return [[self alloc] initWithKey:key];
+}
+
++ (instancetype) identityForBeacon:(CLBeacon *)beacon
+{
+    return [[self alloc] initWithKey:BLEBeaconKeyForBeacon(beacon)];
+}
+
+- (instancetype) initWithKey:(BLEBeaconKey)key
+{
+    if (self = [super init]) {
+        self->_key = key;
+        self->_hash = BLEBeaconKeyHash(key);
+    }
+    return self;
+}
+
+- (NSString *)stringValue
+{
+    @synchronized(self) {
+        if (!_stringValue) {
+            _stringValue = BLEBeaconKeyString(_key);
+        }
+        return _stringValue;
+    }
+}
+
+- (BOOL) isEqualToIdentity:(BLEBeaconIdentity *)identity
+{
+    return _hash == identity->_hash && BLEBeaconKeyEqualToKey(_key, identity->_key);
+}
+
+- (BOOL)isEqual:(id)object
+{
+    if (object == self) {
+        return YES;
+    }
+    if (![object isKindOfClass:[BLEBeaconIdentity class]]) {
+        return NO;
+    }
+    return [self isEqualToIdentity:object];
+}
+
+- (NSUInteger)hash
+{
+    return _hash;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    // immutable
+    return self;
+}
+
+- (NSString *)description
+{
+    return self.stringValue;
+}
+
+@end
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+#import <CoreLocation/CoreLocation.h>
+
+/**
+ *  Error codes for beacon identifier parsing
+ */
+typedef NS_ENUM(NSInteger, BLEBeaconKeyError) {
+    BLEBeaconKeyErrorInvalidIdentifier = 300,
+    BLEBeaconKeyErrorValueOutOfRange
+};
+
+/**
+ *  Components set in the beacon key. Key without major (or minor) matches every beacon in its region (wildcard).
+ */
+typedef NS_OPTIONS(uint8_t, BLEBeaconKeyFields) {
+    BLEBeaconKeyFieldNone  = 0,
+    BLEBeaconKeyFieldMajor = 1 << 0,
+    BLEBeaconKeyFieldMinor = 1 << 1,
+    BLEBeaconKeyFieldAll   = BLEBeaconKeyFieldMajor | BLEBeaconKeyFieldMinor
+};
+
+/**
+ *  Packed (proximityUUID, major, minor) identity of the beacon.
+ */
+typedef struct {
+    uuid_t proximityUUID;
+    uint16_t major;
+    uint16_t minor;
+    BLEBeaconKeyFields fields;
+} BLEBeaconKey;
+
+/**
+ *  Build key from given components. Minor is ignored if major is not set.
+ */
+static inline BLEBeaconKey BLEBeaconKeyMake(NSUUID *proximityUUID, NSNumber *major, NSNumber *minor)
+{
+    BLEBeaconKey key;
+    memset(&key, 0, sizeof(key));
+    [proximityUUID getUUIDBytes:key.proximityUUID];
+    if (major) {
+        key.major = [major unsignedShortValue];
+        key.fields |= BLEBeaconKeyFieldMajor;
+        if (minor) {
+            key.minor = [minor unsignedShortValue];
+            key.fields |= BLEBeaconKeyFieldMinor;
+        }
+    }
+    return key;
+}
+
+/**
+ *  Key for configured or ranged beacon
+ */
+static inline BLEBeaconKey BLEBeaconKeyForBeacon(CLBeacon *beacon)
+{
+    return BLEBeaconKeyMake(beacon.proximityUUID, beacon.major, beacon.minor);
+}
+
+/**
+ *  Key reduced to given fields, eg. UUID+major key for UUID+major+minor key.
+ */
+static inline BLEBeaconKey BLEBeaconKeyWithFields(BLEBeaconKey key, BLEBeaconKeyFields fields)
+{
+    key.fields &= fields;
+    if (!(key.fields & BLEBeaconKeyFieldMajor)) {
+        key.major = 0;
+        key.fields &= ~BLEBeaconKeyFieldMinor;
+    }
+    if (!(key.fields & BLEBeaconKeyFieldMinor)) {
+        key.minor = 0;
+    }
+    return key;
+}
+
+static inline BOOL BLEBeaconKeyEqualToKey(BLEBeaconKey key1, BLEBeaconKey key2)
+{
+    return key1.fields == key2.fields && key1.major == key2.major && key1.minor == key2.minor && memcmp(key1.proximityUUID, key2.proximityUUID, sizeof(uuid_t)) == 0;
+}
+
+/**
+ *  FNV-1a hash of the key
+ */
+static inline NSUInteger BLEBeaconKeyHash(BLEBeaconKey key)
+{
+    uint32_t hash = 2166136261u;
+    for (NSUInteger i = 0; i < sizeof(uuid_t); i++) {
+        hash = (hash ^ key.proximityUUID[i]) * 16777619u;
+    }
+    hash = (hash ^ (key.major >> 8)) * 16777619u;
+    hash = (hash ^ (key.major & 0xFF)) * 16777619u;
+    hash = (hash ^ (key.minor >> 8)) * 16777619u;
+    hash = (hash ^ (key.minor & 0xFF)) * 16777619u;
+    hash = (hash ^ key.fields) * 16777619u;
+    return hash;
+}
+
+/**
+ *  Parse beacon identifier string in format UUID[+major[+minor]], eg. "B9407F30-F5F8-466E-AFF9-25556B57FE6D+1+2".
+ *  Doesn't allocate unless error is returned.
+ *
+ *  @param string Identifier string
+ *  @param key    Parsed key
+ *  @param error  error or nil
+ *
+ *  @return YES if identifier is valid
+ */
+BOOL BLEBeaconKeyFromString(NSString *string, BLEBeaconKey *key, NSError * __autoreleasing *error);
+
+/**
+ *  Identifier string of the key, UUID[+major[+minor]]. Same format as parsed by BLEBeaconKeyFromString.
+ *
+ *  @param key Beacon key
+ *
+ *  @return Identifier string
+ */
+NSString *BLEBeaconKeyString(BLEBeaconKey key);
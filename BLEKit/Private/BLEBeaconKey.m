@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEBeaconKey.h"
+#import "BLEKitTypes.h"
+
+/**
+ *  UUID (36) + "+65535" + "+65535"
+ */
+#define BLEBeaconKeyMaxStringLength 48
+
+static inline int BLEBeaconKeyHexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static BOOL BLEBeaconKeyFail(NSString *string, BLEBeaconKeyError code, NSString *reason, NSError * __autoreleasing *error)
+{
+    if (error) {
+        NSString *description = [NSString stringWithFormat:@"Defined beacon identifier '%@' is invalid. %@", string, reason];
+        *error = [NSError errorWithDomain:BLEErrorDomain code:code userInfo:@{NSLocalizedDescriptionKey: description}];
+    }
+    return NO;
+}
+
+/**
+ *  Parse decimal uint16_t, advance pointer
+ */
+static BOOL BLEBeaconKeyParseValue(const char **p, uint16_t *value, BOOL *outOfRange)
+{
+    uint32_t result = 0;
+    NSUInteger digits = 0;
+    while (**p >= '0' && **p <= '9') {
+        result = result * 10 + (uint32_t)(**p - '0');
+        (*p)++;
+        if (++digits > 5 || result > UINT16_MAX) {
+            *outOfRange = YES;
+            return NO;
+        }
+    }
+    *value = (uint16_t)result;
+    return digits > 0;
+}
+
+BOOL BLEBeaconKeyFromString(NSString *string, BLEBeaconKey *key, NSError * __autoreleasing *error)
+{
+    NSCParameterAssert(key);
+
+    char buffer[BLEBeaconKeyMaxStringLength + 1];
+    const char *chars = string ? CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingASCII) : NULL;
+    if (!chars) {
+        if (![string isKindOfClass:[NSString class]] || ![string getCString:buffer maxLength:sizeof(buffer) encoding:NSASCIIStringEncoding]) {
+            return BLEBeaconKeyFail(string, BLEBeaconKeyErrorInvalidIdentifier, @"Expected UUID[+major[+minor]].", error);
+        }
+        chars = buffer;
+    }
+
+    BLEBeaconKey result;
+    memset(&result, 0, sizeof(result));
+
+    // UUID 8-4-4-4-12, NUL terminator stops at invalid hex digit
+    static const NSUInteger groups[] = {8, 4, 4, 4, 12};
+    const char *p = chars;
+    NSUInteger byte = 0;
+    for (NSUInteger group = 0; group < sizeof(groups) / sizeof(groups[0]); group++) {
+        if (group > 0 && *p++ != '-') {
+            return BLEBeaconKeyFail(string, BLEBeaconKeyErrorInvalidIdentifier, @"Invalid proximity UUID.", error);
+        }
+        for (NSUInteger i = 0; i < groups[group] / 2; i++) {
+            int high = BLEBeaconKeyHexValue(p[0]);
+            int low = high < 0 ? -1 : BLEBeaconKeyHexValue(p[1]);
+            if (low < 0) {
+                return BLEBeaconKeyFail(string, BLEBeaconKeyErrorInvalidIdentifier, @"Invalid proximity UUID.", error);
+            }
+            result.proximityUUID[byte++] = (uint8_t)((high << 4) | low);
+            p += 2;
+        }
+    }
+
+    BOOL outOfRange = NO;
+    if (*p == '+') {
+        p++;
+        if (!BLEBeaconKeyParseValue(&p, &result.major, &outOfRange)) {
+            return BLEBeaconKeyFail(string, outOfRange ? BLEBeaconKeyErrorValueOutOfRange : BLEBeaconKeyErrorInvalidIdentifier, outOfRange ? @"Major is out of range 0-65535." : @"Invalid major.", error);
+        }
+        result.fields |= BLEBeaconKeyFieldMajor;
+
+        if (*p == '+') {
+            p++;
+            if (!BLEBeaconKeyParseValue(&p, &result.minor, &outOfRange)) {
+                return BLEBeaconKeyFail(string, outOfRange ? BLEBeaconKeyErrorValueOutOfRange : BLEBeaconKeyErrorInvalidIdentifier, outOfRange ? @"Minor is out of range 0-65535." : @"Invalid minor.", error);
+            }
+            result.fields |= BLEBeaconKeyFieldMinor;
+        }
+    }
+
+    if (*p != '\0') {
+        return BLEBeaconKeyFail(string, BLEBeaconKeyErrorInvalidIdentifier, @"Unexpected characters after identifier.", error);
+    }
+
+    *key = result;
+    return YES;
+}
+
+NSString *BLEBeaconKeyString(BLEBeaconKey key)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+    char buffer[BLEBeaconKeyMaxStringLength + 1];
+    NSUInteger length = 0;
+
+    for (NSUInteger i = 0; i < sizeof(uuid_t); i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            buffer[length++] = '-';
+        }
+        buffer[length++] = hexDigits[key.proximityUUID[i] >> 4];
+        buffer[length++] = hexDigits[key.proximityUUID[i] & 0x0F];
+    }
+
+    if (key.fields & BLEBeaconKeyFieldMajor) {
+        length += (NSUInteger)snprintf(buffer + length, sizeof(buffer) - length, "+%u", key.major);
+        if (key.fields & BLEBeaconKeyFieldMinor) {
+            length += (NSUInteger)snprintf(buffer + length, sizeof(buffer) - length, "+%u", key.minor);
+        }
+    }
+
+    return [[NSString alloc] initWithBytes:buffer length:length encoding:NSASCIIStringEncoding];
+}
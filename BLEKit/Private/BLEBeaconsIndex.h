@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+#import "BLEBeaconKey.h"
+
+/**
+ *  Max number of configured beacons matching single ranged beacon (UUID+major+minor, UUID+major, UUID)
+ */
+#define BLEBeaconsIndexMaxMatches 3
+
+@class BLEBeacon;
+
+/**
+ *  Prebuilt lookup table for configured beacons.
+ *
+ *  Built once for set of beacons, so lookups from region and ranging callbacks
+ *  don't have to scan all beacons.
+ */
+@interface BLEBeaconsIndex : NSObject
+
+/**
+ *  Number of indexed beacons. Every beacon have slot in range 0..count-1
+ */
+@property (assign, readonly) NSUInteger count;
+
+/**
+ *  Initialize index with beacons
+ *
+ *  @param beacons Set of beacons. @c BLEBeacon
+ *
+ *  @return Initialized object
+ */
+- (instancetype) initWithBeacons:(NSSet *)beacons;
+
+/**
+ *  Beacon for identifier
+ *
+ *  @param identifier Beacon (or region) identifier
+ *
+ *  @return Beacon or nil
+ */
+- (BLEBeacon *) beaconForIdentifier:(NSString *)identifier;
+
+/**
+ *  Beacon at slot
+ *
+ *  @param slot slot number, less than count
+ *
+ *  @return Beacon
+ */
+- (BLEBeacon *) beaconAtSlot:(NSUInteger)slot;
+
+/**
+ *  Slots of configured beacons matching the key. Wildcard beacons (UUID only or UUID+major) are resolved here too.
+ *
+ *  @param slots Buffer for at least BLEBeaconsIndexMaxMatches slots
+ *  @param key   Key of ranged beacon
+ *
+ *  @return Number of slots written to buffer, from the most specific.
+ */
+- (NSUInteger) getSlots:(NSUInteger *)slots matchingKey:(BLEBeaconKey)key;
+
+@end
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEBeaconsIndex.h"
+#import "BLEBeacon.h"
+#import "BLEKitPrivate.h"
+
+/**
+ *  Open addressing hash table BLEBeaconKey -> slot
+ */
+typedef struct {
+    BLEBeaconKey key;
+    NSInteger slot;
+} BLEBeaconsIndexEntry;
+
+@implementation BLEBeaconsIndex {
+    NSDictionary *_beaconsByIdentifier;
+    NSArray *_beaconsBySlot;
+    BLEBeaconsIndexEntry *_entries;
+    NSUInteger _entriesMask;
+}
+
+- (instancetype) initWithBeacons:(NSSet *)beacons
+{
+    if (self = [self init]) {
+        NSUInteger capacity = 8;
+        while (capacity < beacons.count * 2) {
+            capacity <<= 1;
+        }
+        self->_entries = malloc(capacity * sizeof(BLEBeaconsIndexEntry));
+        self->_entriesMask = capacity - 1;
+        for (NSUInteger i = 0; i < capacity; i++) {
+            self->_entries[i].slot = NSNotFound;
+        }
+
+        NSMutableDictionary *beaconsByIdentifier = [NSMutableDictionary dictionaryWithCapacity:beacons.count];
+        NSMutableArray *beaconsBySlot = [NSMutableArray arrayWithCapacity:beacons.count];
+        for (BLEBeacon *beacon in beacons) {
+            if (beacon.identifier) {
+                beaconsByIdentifier[beacon.identifier] = beacon;
+            }
+            if (beacon.proximityUUID) {
+                [self insertKey:[beacon beaconKey] slot:beaconsBySlot.count];
+                [beaconsBySlot addObject:beacon];
+            }
+        }
+        self->_beaconsByIdentifier = [beaconsByIdentifier copy];
+        self->_beaconsBySlot = [beaconsBySlot copy];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_entries);
+}
+
+- (NSUInteger)count
+{
+    return _beaconsBySlot.count;
+}
+
+#pragma mark - Table
+
+- (void) insertKey:(BLEBeaconKey)key slot:(NSUInteger)slot
+{
+    NSUInteger idx = BLEBeaconKeyHash(key) & _entriesMask;
+    while (_entries[idx].slot != NSNotFound) {
+        if (BLEBeaconKeyEqualToKey(_entries[idx].key, key)) {
+            // duplicated definition, first one wins
+            return;
+        }
+        idx = (idx + 1) & _entriesMask;
+    }
+    _entries[idx].key = key;
+    _entries[idx].slot = slot;
+}
+
+- (NSInteger) slotForKey:(BLEBeaconKey)key
+{
+    NSUInteger idx = BLEBeaconKeyHash(key) & _entriesMask;
+    while (_entries[idx].slot != NSNotFound) {
+        if (BLEBeaconKeyEqualToKey(_entries[idx].key, key)) {
+            return _entries[idx].slot;
+        }
+        idx = (idx + 1) & _entriesMask;
+    }
+    return NSNotFound;
+}
+
+#pragma mark - Lookup
+
+- (BLEBeacon *) beaconForIdentifier:(NSString *)identifier
+{
+    if (!identifier) {
+        return nil;
+    }
+    return _beaconsByIdentifier[identifier];
+}
+
+- (BLEBeacon *) beaconAtSlot:(NSUInteger)slot
+{
+    return _beaconsBySlot[slot];
+}
+
+- (NSUInteger) getSlots:(NSUInteger *)slots matchingKey:(BLEBeaconKey)key
+{
+    NSUInteger count = 0;
+    static const BLEBeaconKeyFields prefixes[BLEBeaconsIndexMaxMatches] = {BLEBeaconKeyFieldAll, BLEBeaconKeyFieldMajor, BLEBeaconKeyFieldNone};
+    for (NSUInteger i = 0; i < BLEBeaconsIndexMaxMatches; i++) {
+        // skip prefixes not narrower than the key itself
+        if ((key.fields & prefixes[i]) != prefixes[i]) {
+            continue;
+        }
+        NSInteger slot = [self slotForKey:BLEBeaconKeyWithFields(key, prefixes[i])];
+        if (slot != NSNotFound) {
+            slots[count++] = slot;
+        }
+    }
+    return count;
+}
+
+@end
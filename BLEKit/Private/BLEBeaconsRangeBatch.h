@@ -29,27 +29,47 @@
 #import <Foundation/Foundation.h>
 #import <CoreLocation/CoreLocation.h>
 
+#import "BLEBeaconKey.h"
+
+/**
+ *  Single ranging sample
+ */
+typedef struct {
+    /**
+     *  Packed identity of ranged beacon
+     */
+    BLEBeaconKey key;
+    NSInteger rssi;
+    CLLocationAccuracy accuracy;
+    CLProximity proximity;
+    /**
+     *  Monotonic time of the sample
+     *  @see BLEMonotonicTime
+     */
+    NSTimeInterval timestamp;
+} BLERangeSample;
+
 @class BLEBeaconsRangeBatch;
 
 @protocol BLEBeaconsRangeBatchDelegate <NSObject>
 /**
  *  Process ranged batch
  *
- *  @param batch         Batch object
- *  @param rangedBeacons Ranged beacons
+ *  @param batch      Batch object
+ *  @param samples    Ranged samples. Valid only for the time of the call.
+ *  @param count      Number of samples
+ *  @param identifier Identifier of ranged region
  */
-- (void) processRangeBatch:(BLEBeaconsRangeBatch *)batch beacons:(NSArray *)rangedBeacons;
+- (void) processRangeBatch:(BLEBeaconsRangeBatch *)batch samples:(const BLERangeSample *)samples count:(NSUInteger)count regionIdentifier:(NSString *)identifier;
 @end
 
 /**
  * Cumulate ranged beacons for region and process every given period of time
  * this is workaround to be sure that we gather all near beacons already
+ *
+ * Samples are stored in fixed capacity ring buffer per region, if there is more samples in time frame then the oldest are overwritten.
  */
 @interface BLEBeaconsRangeBatch : NSObject
-/**
- *  Current batch
- */
-@property (strong) NSMutableDictionary *batch;
 /**
  *  Regions in current batch
  */
@@ -76,7 +96,7 @@
 /**
  *  Add ranged beacons to batch
  *
- *  @param rangedBeacons Array of ranged beacons data (NSDictionary)
+ *  @param rangedBeacons Array of ranged beacons (CLBeacon)
  *  @param region        region
  */
 - (void) add:(NSArray *)rangedBeacons forRegion:(CLBeaconRegion *)region;
@@ -27,15 +27,84 @@
  */
 
 #import "BLEBeaconsRangeBatch.h"
+#import "BLEMonotonicClock.h"
 
 #define BLERangingSecondsTimeFrame 2
 
 // timeout value since last read. After that amount of time batch is cheared out
 #define BLERangingSecondsTimeout 120
 
-static NSDate *lastRanging;
+// max number of samples kept for region in single time frame
+#define BLERangingBatchCapacity 256
 
-@implementation BLEBeaconsRangeBatch
+/**
+ *  Ring buffer with samples for single region
+ */
+@interface BLEBeaconsRangeRegionBatch : NSObject
+@property (assign) NSTimeInterval refTime;
+@property (assign) NSUInteger start;
+@property (assign) NSUInteger count;
+@property (assign, readonly) BLERangeSample *samples;
+@end
+
+@implementation BLEBeaconsRangeRegionBatch
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        self->_samples = calloc(BLERangingBatchCapacity, sizeof(BLERangeSample));
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_samples);
+}
+
+- (void) resetWithTime:(NSTimeInterval)time
+{
+    self.start = 0;
+    self.count = 0;
+    self.refTime = time;
+}
+
+- (void) addSample:(BLERangeSample)sample
+{
+    if (self.count < BLERangingBatchCapacity) {
+        _samples[(self.start + self.count) % BLERangingBatchCapacity] = sample;
+        self.count++;
+    } else {
+        // full, overwrite the oldest one
+        _samples[self.start] = sample;
+        self.start = (self.start + 1) % BLERangingBatchCapacity;
+    }
+}
+
+- (void) copySamplesTo:(BLERangeSample *)buffer
+{
+    NSUInteger firstPart = MIN(self.count, BLERangingBatchCapacity - self.start);
+    memcpy(buffer, _samples + self.start, firstPart * sizeof(BLERangeSample));
+    memcpy(buffer + firstPart, _samples, (self.count - firstPart) * sizeof(BLERangeSample));
+}
+
+@end
+
+@implementation BLEBeaconsRangeBatch {
+    NSMutableDictionary *_regionBatches;
+    BLERangeSample *_flushBuffer;
+    NSTimeInterval _lastRanging;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _regionBatches = [NSMutableDictionary dictionary];
+        _flushBuffer = calloc(BLERangingBatchCapacity, sizeof(BLERangeSample));
+        _lastRanging = -BLERangingSecondsTimeout;
+    }
+    return self;
+}
 
 - (instancetype) initWithDelegate:(id <BLEBeaconsRangeBatchDelegate>)delegate
 {
@@ -45,46 +114,59 @@ static NSDate *lastRanging;
     return self;
 }
 
+- (void)dealloc
+{
+    free(_flushBuffer);
+}
 
 - (void) add:(NSArray *)rangedBeacons forRegion:(CLBeaconRegion *)region
 {
     @synchronized(self) {
-        if (!self.batch) {
-            self.batch = [NSMutableDictionary dictionary];
-            [self resetForRegion:region];
+        NSTimeInterval now = BLEMonotonicTime();
+
+        BLEBeaconsRangeRegionBatch *regionBatch = _regionBatches[region.identifier];
+        if (!regionBatch) {
+            regionBatch = [[BLEBeaconsRangeRegionBatch alloc] init];
+            [regionBatch resetWithTime:now];
+            _regionBatches[region.identifier] = regionBatch;
         }
-        
-        NSTimeInterval timeIntervalSinceLastRanging = [[NSDate date] timeIntervalSinceDate:lastRanging ?: [NSDate dateWithTimeIntervalSinceReferenceDate:0]];
-        if (timeIntervalSinceLastRanging >= BLERangingSecondsTimeout) {
-            [self resetForRegion:region];
+
+        if (now - _lastRanging >= BLERangingSecondsTimeout) {
+            [regionBatch resetWithTime:now];
         }
-        
-        lastRanging = [NSDate date];
-        
-        NSArray *beaconsInBatch = self.batch[region.identifier][@"beacons"];
-        if (beaconsInBatch.count > 0) {
-            // if time elapsed from the last read is significant I assume that there was
-            // break and batch is processed as new
-            NSDate *refDate = self.batch[region.identifier][@"refdate"];
-            NSTimeInterval timeInterval = [[NSDate date] timeIntervalSinceDate:refDate];
-            if (timeInterval >= BLERangingSecondsTimeout) {
-                [self resetForRegion:region];
-            }
-            // expand
-            beaconsInBatch = [beaconsInBatch arrayByAddingObjectsFromArray:rangedBeacons];
-            self.batch[region.identifier] = @{@"refdate": refDate, @"beacons": beaconsInBatch};
-
-            // reset batch after rangingTimeFrame
-            if (timeInterval >= BLERangingSecondsTimeFrame && timeInterval < BLERangingSecondsTimeout) {
-                id <BLEBeaconsRangeBatchDelegate> delegateStrong = self.delegate;
-                if ([delegateStrong conformsToProtocol:@protocol(BLEBeaconsRangeBatchDelegate)]) {
-                    [delegateStrong processRangeBatch:self beacons:beaconsInBatch];
-                }
-                [self resetForRegion:region];
+        _lastRanging = now;
+
+        BOOL hadSamples = regionBatch.count > 0;
+        // if time elapsed from the last read is significant I assume that there was
+        // break and batch is processed as new
+        NSTimeInterval timeInterval = now - regionBatch.refTime;
+        if (!hadSamples || timeInterval >= BLERangingSecondsTimeout) {
+            [regionBatch resetWithTime:now];
+            hadSamples = NO;
+            timeInterval = 0;
+        }
+
+        // expand
+        for (CLBeacon *rangedBeacon in rangedBeacons) {
+            BLERangeSample sample;
+            sample.key = BLEBeaconKeyForBeacon(rangedBeacon);
+            sample.rssi = rangedBeacon.rssi;
+            sample.accuracy = rangedBeacon.accuracy;
+            sample.proximity = rangedBeacon.proximity;
+            sample.timestamp = now;
+            [regionBatch addSample:sample];
+        }
+
+        // process and reset batch after rangingTimeFrame
+        if (hadSamples && timeInterval >= BLERangingSecondsTimeFrame) {
+            NSUInteger count = regionBatch.count;
+            [regionBatch copySamplesTo:_flushBuffer];
+            [regionBatch resetWithTime:now];
+
+            id <BLEBeaconsRangeBatchDelegate> delegateStrong = self.delegate;
+            if ([delegateStrong conformsToProtocol:@protocol(BLEBeaconsRangeBatchDelegate)]) {
+                [delegateStrong processRangeBatch:self samples:_flushBuffer count:count regionIdentifier:region.identifier];
             }
-        } else {
-            // init with ranged beacons
-            self.batch[region.identifier] = @{@"refdate": [NSDate date], @"beacons": rangedBeacons};
         }
     }
 }
@@ -92,13 +174,8 @@ static NSDate *lastRanging;
 - (NSArray *) regions
 {
     @synchronized(self) {
-        return [self.batch allKeys];
+        return [_regionBatches allKeys];
     }
 }
 
-- (void) resetForRegion:(CLBeaconRegion *)region
-{
-    self.batch[region.identifier] = @{@"refdate": [NSDate date], @"beacons": [NSArray array]};
-}
-
 @end
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+@class BLEConditionExpression;
+
+/**
+ *  Version of bytecode layout, bytecode of other version is rejected
+ */
+#define BLEConditionExpressionBytecodeVersion 1
+
+/**
+ *  Error codes for expression compilation
+ */
+typedef NS_ENUM(NSInteger, BLEConditionExpressionError) {
+    BLEConditionExpressionErrorSyntax = 100,
+    BLEConditionExpressionErrorType,
+    BLEConditionExpressionErrorUnknownIdentifier,
+    BLEConditionExpressionErrorUnsupported,
+    BLEConditionExpressionErrorInvalidBytecode
+};
+
+/**
+ *  Value slots available in expression. Resolved at compile time.
+ */
+typedef NS_ENUM(NSInteger, BLEConditionExpressionSlot) {
+    // Numbers
+    BLEConditionExpressionSlotDistance = 0,
+    BLEConditionExpressionSlotOccurrence,
+    BLEConditionExpressionSlotStays,
+    BLEConditionExpressionSlotStaysInterval,
+    BLEConditionExpressionSlotBeaconProximity,
+    BLEConditionExpressionSlotBeaconAccuracy,
+    BLEConditionExpressionSlotBeaconRSSI,
+    // Strings
+    BLEConditionExpressionSlotBeaconIdentifier,
+    BLEConditionExpressionSlotBeaconName,
+    BLEConditionExpressionSlotBeaconDesc,
+    BLEConditionExpressionSlotZoneIdentifier,
+    BLEConditionExpressionSlotZoneName,
+    BLEConditionExpressionSlotZoneDesc,
+    BLEConditionExpressionSlotActionType,
+    BLEConditionExpressionSlotActionUniqueIdentifier,
+    BLEConditionExpressionSlotTriggerName,
+    BLEConditionExpressionSlotTriggerUniqueIdentifier,
+
+    BLEConditionExpressionSlotCount
+};
+
+/**
+ *  Provides values for slots at evaluation time.
+ */
+@protocol BLEConditionExpressionContext <NSObject>
+/**
+ *  Number value for slot. NAN if value is not available (comparison is false).
+ */
+- (double) conditionExpression:(BLEConditionExpression *)expression numberForSlot:(BLEConditionExpressionSlot)slot;
+/**
+ *  String value for slot or nil.
+ */
+- (NSString *) conditionExpression:(BLEConditionExpression *)expression stringForSlot:(BLEConditionExpressionSlot)slot;
+@end
+
+/**
+ *  Compiled condition expression.
+ *
+ *  Supports NSPredicate-like syntax used in zone configuration:
+ *  comparisons (=, ==, !=, <>, <, <=, =<, >, >=, =>), AND (&&), OR (||), NOT (!), parentheses,
+ *  arithmetic (+, -, *, /), IN {..} and BETWEEN {..} with number lists, TRUEPREDICATE, FALSEPREDICATE, YES, NO,
+ *  number and string literals, variables ($occurrence, $stays, $isNear, ...) and key paths (distance, occurrence, beacon.name, zone.identifier, ...).
+ *
+ *  Expression is type checked and compiled to bytecode with slots resolved at compile time,
+ *  so evaluation doesn't parse, doesn't use KVC and doesn't throw.
+ *  Anything else is reported as error and caller may fallback to NSPredicate.
+ */
+@interface BLEConditionExpression : NSObject
+
+/**
+ *  Source of the expression
+ */
+@property (strong, readonly) NSString *source;
+
+/**
+ *  Compile expression
+ *
+ *  @param string Expression string
+ *  @param error  error or nil
+ *
+ *  @return Compiled expression or nil if expression can't be compiled
+ */
+- (instancetype) initWithString:(NSString *)string error:(NSError * __autoreleasing *)error;
+
+/**
+ *  Compile "AND" expression for condition parameters dictionary. Every key compare equal to its value.
+ *
+ *  @param parameters         Parameters (key path : value)
+ *  @param greaterOrEqualKeys Keys compared with >= instead of =
+ *  @param excludedKeys       Keys skipped
+ *  @param error              error or nil
+ *
+ *  @return Compiled expression or nil if parameters can't be compiled
+ */
+- (instancetype) initWithParameters:(NSDictionary *)parameters greaterOrEqualKeys:(NSSet *)greaterOrEqualKeys excludedKeys:(NSSet *)excludedKeys error:(NSError * __autoreleasing *)error;
+
+/**
+ *  Load expression compiled before. Bytecode is verified before use.
+ *
+ *  @param bytecode Bytecode
+ *  @param source   Source of the expression or nil
+ *  @param error    error or nil
+ *
+ *  @return Expression or nil if bytecode is invalid
+ *  @see bytecode
+ */
+- (instancetype) initWithBytecode:(NSData *)bytecode source:(NSString *)source error:(NSError * __autoreleasing *)error;
+
+/**
+ *  Compiled expression, can be stored and loaded with initWithBytecode:source:error:
+ */
+- (NSData *) bytecode;
+
+/**
+ *  Check if expression use given slot
+ */
+- (BOOL) usesSlot:(BLEConditionExpressionSlot)slot;
+
+/**
+ *  Evaluate expression
+ *
+ *  @param context Values provider
+ *
+ *  @return Result
+ */
+- (BOOL) evaluateWithContext:(id <BLEConditionExpressionContext>)context;
+
+@end
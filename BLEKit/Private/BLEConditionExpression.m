@@ -0,0 +1,1101 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEConditionExpression.h"
+#import "BLEKitTypes.h"
+
+#import <CoreLocation/CoreLocation.h>
+
+#define BLEConditionExpressionMaxStack 32
+
+typedef NS_ENUM(uint8_t, BLEExpressionOp) {
+    BLEExpressionOpPush = 0,        // arg: number constant index
+    BLEExpressionOpLoad,            // arg: slot
+    BLEExpressionOpAdd,
+    BLEExpressionOpSubtract,
+    BLEExpressionOpMultiply,
+    BLEExpressionOpDivide,
+    BLEExpressionOpNegate,
+    BLEExpressionOpEqual,
+    BLEExpressionOpNotEqual,
+    BLEExpressionOpLess,
+    BLEExpressionOpLessOrEqual,
+    BLEExpressionOpGreater,
+    BLEExpressionOpGreaterOrEqual,
+    BLEExpressionOpIn,              // arg: first number constant, arg2: number of constants
+    BLEExpressionOpBetween,         // arg: first number constant (lower, upper)
+    BLEExpressionOpStringEqual,     // arg, arg2: string operands
+    BLEExpressionOpStringNotEqual,  // arg, arg2: string operands
+    BLEExpressionOpNot,
+    BLEExpressionOpJumpIfFalse,     // arg: target. Keep value if jump, pop otherwise
+    BLEExpressionOpJumpIfTrue       // arg: target. Keep value if jump, pop otherwise
+};
+
+typedef struct {
+    BLEExpressionOp op;
+    int32_t arg;
+    int32_t arg2;
+} BLEExpressionInstruction;
+
+typedef NS_ENUM(NSInteger, BLEExpressionType) {
+    BLEExpressionTypeBool = 0,
+    BLEExpressionTypeNumber,
+    BLEExpressionTypeString
+};
+
+/**
+ *  Parsed (sub)expression. Bool and Number values are already emitted on the stack,
+ *  String is kept as operand: constant index (>= 0) or slot (-(slot + 1)).
+ */
+typedef struct {
+    BLEExpressionType type;
+    int32_t stringOperand;
+} BLEExpressionValue;
+
+typedef NS_ENUM(NSInteger, BLEExpressionTokenType) {
+    BLEExpressionTokenEnd = 0,
+    BLEExpressionTokenNumber,
+    BLEExpressionTokenString,
+    BLEExpressionTokenIdentifier,
+    BLEExpressionTokenVariable,
+    BLEExpressionTokenOperator
+};
+
+@interface BLEConditionExpressionToken : NSObject
+@property (assign) BLEExpressionTokenType type;
+@property (strong) NSString *text;
+@property (assign) double number;
+@property (assign) NSUInteger position;
+@end
+
+@implementation BLEConditionExpressionToken
+@end
+
+static NSDictionary *BLEConditionExpressionKeyPaths;
+static NSDictionary *BLEConditionExpressionVariables;
+static NSDictionary *BLEConditionExpressionConstants;
+
+static inline BOOL BLEConditionExpressionSlotIsString(BLEConditionExpressionSlot slot)
+{
+    return slot >= BLEConditionExpressionSlotBeaconIdentifier;
+}
+
+@implementation BLEConditionExpression {
+    NSMutableData *_code;
+    NSMutableData *_numbers;
+    NSMutableArray *_strings;
+    uint32_t _slots;
+
+    // compilation state
+    NSArray *_tokens;
+    NSUInteger _tokenIndex;
+    NSInteger _depth;
+    NSInteger _maxDepth;
+    NSError *_error;
+}
+
++ (void)initialize
+{
+    if (self == [BLEConditionExpression class]) {
+        BLEConditionExpressionKeyPaths = @{@"distance": @(BLEConditionExpressionSlotDistance),
+                                           @"occurrence": @(BLEConditionExpressionSlotOccurrence),
+                                           @"interval": @(BLEConditionExpressionSlotStaysInterval),
+                                           @"beacon.proximity": @(BLEConditionExpressionSlotBeaconProximity),
+                                           @"beacon.accuracy": @(BLEConditionExpressionSlotBeaconAccuracy),
+                                           @"beacon.rssi": @(BLEConditionExpressionSlotBeaconRSSI),
+                                           @"beacon.identifier": @(BLEConditionExpressionSlotBeaconIdentifier),
+                                           @"beacon.name": @(BLEConditionExpressionSlotBeaconName),
+                                           @"beacon.desc": @(BLEConditionExpressionSlotBeaconDesc),
+                                           @"zone.identifier": @(BLEConditionExpressionSlotZoneIdentifier),
+                                           @"zone.name": @(BLEConditionExpressionSlotZoneName),
+                                           @"zone.desc": @(BLEConditionExpressionSlotZoneDesc),
+                                           @"action.type": @(BLEConditionExpressionSlotActionType),
+                                           @"action.uniqueIdentifier": @(BLEConditionExpressionSlotActionUniqueIdentifier),
+                                           @"trigger.name": @(BLEConditionExpressionSlotTriggerName),
+                                           @"trigger.uniqueIdentifier": @(BLEConditionExpressionSlotTriggerUniqueIdentifier)};
+
+        BLEConditionExpressionVariables = @{@"occurrence": @(BLEConditionExpressionSlotOccurrence),
+                                            @"stays": @(BLEConditionExpressionSlotStays)};
+
+        BLEConditionExpressionConstants = @{@"isNear": @(CLProximityNear),
+                                            @"isImmediate": @(CLProximityImmediate),
+                                            @"isFar": @(CLProximityFar),
+                                            @"cameNear": @(CLProximityNear),
+                                            @"cameImmediate": @(CLProximityImmediate),
+                                            @"cameFar": @(CLProximityFar)};
+    }
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _code = [NSMutableData data];
+        _numbers = [NSMutableData data];
+        _strings = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (instancetype) initWithString:(NSString *)string error:(NSError * __autoreleasing *)error
+{
+    NSParameterAssert(string);
+
+    if (self = [self init]) {
+        _source = [string copy];
+        _tokens = [self tokenize:string];
+
+        BLEExpressionValue value;
+        BOOL success = _tokens && [self parseOr:&value];
+        if (success && [self currentToken].type != BLEExpressionTokenEnd) {
+            success = [self failWithCode:BLEConditionExpressionErrorSyntax reason:@"Unexpected token"];
+        }
+        if (success && value.type != BLEExpressionTypeBool) {
+            success = [self failWithCode:BLEConditionExpressionErrorType reason:@"Expression is not a predicate"];
+        }
+        _tokens = nil;
+
+        if (!success) {
+            if (error) {
+                *error = _error;
+            }
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (instancetype) initWithParameters:(NSDictionary *)parameters greaterOrEqualKeys:(NSSet *)greaterOrEqualKeys excludedKeys:(NSSet *)excludedKeys error:(NSError * __autoreleasing *)error
+{
+    if (self = [self init]) {
+        _source = [parameters description];
+
+        NSMutableArray *jumps = [NSMutableArray arrayWithCapacity:parameters.count];
+        BOOL success = YES;
+        for (NSString *key in [[parameters allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+            if ([excludedKeys containsObject:key]) {
+                continue;
+            }
+
+            NSNumber *slotNumber = [key isKindOfClass:[NSString class]] ? BLEConditionExpressionKeyPaths[key] : nil;
+            if (!slotNumber) {
+                success = [self failWithCode:BLEConditionExpressionErrorUnknownIdentifier reason:[NSString stringWithFormat:@"Unknown parameter '%@'", key]];
+                break;
+            }
+
+            if (jumps.count > 0 || _depth > 0) {
+                [jumps addObject:@([self emit:BLEExpressionOpJumpIfFalse arg:0 arg2:0])];
+            }
+
+            BLEConditionExpressionSlot slot = [slotNumber integerValue];
+            id value = parameters[key];
+            BOOL greaterOrEqual = [greaterOrEqualKeys containsObject:key];
+            if (BLEConditionExpressionSlotIsString(slot)) {
+                if (greaterOrEqual || ![value isKindOfClass:[NSString class]]) {
+                    success = [self failWithCode:BLEConditionExpressionErrorType reason:[NSString stringWithFormat:@"Invalid value for parameter '%@'", key]];
+                    break;
+                }
+                [self emit:BLEExpressionOpStringEqual arg:[self stringOperandForSlot:slot] arg2:[self stringOperandForConstant:value]];
+            } else {
+                double number = 0;
+                if (greaterOrEqual && [value respondsToSelector:@selector(integerValue)]) {
+                    number = [value integerValue];
+                } else if ([value isKindOfClass:[NSNumber class]]) {
+                    number = [value doubleValue];
+                } else {
+                    success = [self failWithCode:BLEConditionExpressionErrorType reason:[NSString stringWithFormat:@"Invalid value for parameter '%@'", key]];
+                    break;
+                }
+                [self emit:BLEExpressionOpLoad arg:(int32_t)slot arg2:0];
+                [self emit:BLEExpressionOpPush arg:[self addNumber:number] arg2:0];
+                [self emit:greaterOrEqual ? BLEExpressionOpGreaterOrEqual : BLEExpressionOpEqual arg:0 arg2:0];
+            }
+        }
+
+        if (success && _depth == 0) {
+            // no parameters, always true
+            [self emit:BLEExpressionOpPush arg:[self addNumber:1] arg2:0];
+        }
+
+        for (NSNumber *jump in jumps) {
+            [self patchJump:[jump unsignedIntegerValue]];
+        }
+
+        if (!success) {
+            if (error) {
+                *error = _error;
+            }
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (NSString *)description
+{
+    return self.source;
+}
+
+#pragma mark - Bytecode
+
+/**
+ *  Layout: count, number count, string count, slots (uint32_t each),
+ *  instructions (op uint8_t, arg int32_t, arg2 int32_t), numbers (double), strings (uint32_t length, UTF-8).
+ */
+- (NSData *) bytecode
+{
+    NSUInteger count = _code.length / sizeof(BLEExpressionInstruction);
+    uint32_t header[4] = {(uint32_t)count, (uint32_t)(_numbers.length / sizeof(double)), (uint32_t)_strings.count, _slots};
+
+    NSMutableData *data = [NSMutableData dataWithCapacity:sizeof(header) + count * 9 + _numbers.length];
+    [data appendBytes:header length:sizeof(header)];
+
+    const BLEExpressionInstruction *code = _code.bytes;
+    for (NSUInteger i = 0; i < count; i++) {
+        uint8_t op = code[i].op;
+        [data appendBytes:&op length:sizeof(op)];
+        [data appendBytes:&code[i].arg length:sizeof(int32_t)];
+        [data appendBytes:&code[i].arg2 length:sizeof(int32_t)];
+    }
+    [data appendData:_numbers];
+    for (NSString *string in _strings) {
+        NSData *stringData = [string dataUsingEncoding:NSUTF8StringEncoding];
+        uint32_t length = (uint32_t)stringData.length;
+        [data appendBytes:&length length:sizeof(length)];
+        [data appendData:stringData];
+    }
+    return [data copy];
+}
+
+- (instancetype) initWithBytecode:(NSData *)bytecode source:(NSString *)source error:(NSError * __autoreleasing *)error
+{
+    NSParameterAssert(bytecode);
+
+    if (self = [self init]) {
+        _source = [source copy];
+        if (![self loadBytecode:bytecode] || ![self verify]) {
+            if (error) {
+                *error = [NSError errorWithDomain:BLEErrorDomain code:BLEConditionExpressionErrorInvalidBytecode userInfo:@{NSLocalizedDescriptionKey: @"Invalid expression bytecode"}];
+            }
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (BOOL) loadBytecode:(NSData *)bytecode
+{
+    const uint8_t *bytes = bytecode.bytes;
+    NSUInteger length = bytecode.length;
+    uint32_t header[4];
+    if (length < sizeof(header)) {
+        return NO;
+    }
+    memcpy(header, bytes, sizeof(header));
+    NSUInteger offset = sizeof(header);
+
+    uint32_t count = header[0];
+    uint32_t numbersCount = header[1];
+    uint32_t stringsCount = header[2];
+    if ((length - offset) / 9 < count) {
+        return NO;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        BLEExpressionInstruction instruction;
+        instruction.op = bytes[offset];
+        memcpy(&instruction.arg, bytes + offset + 1, sizeof(int32_t));
+        memcpy(&instruction.arg2, bytes + offset + 5, sizeof(int32_t));
+        [_code appendBytes:&instruction length:sizeof(instruction)];
+        offset += 9;
+    }
+
+    if ((length - offset) / sizeof(double) < numbersCount) {
+        return NO;
+    }
+    [_numbers appendBytes:bytes + offset length:numbersCount * sizeof(double)];
+    offset += numbersCount * sizeof(double);
+
+    for (uint32_t i = 0; i < stringsCount; i++) {
+        uint32_t stringLength;
+        if (length - offset < sizeof(stringLength)) {
+            return NO;
+        }
+        memcpy(&stringLength, bytes + offset, sizeof(stringLength));
+        offset += sizeof(stringLength);
+        if (length - offset < stringLength) {
+            return NO;
+        }
+        NSString *string = [[NSString alloc] initWithBytes:bytes + offset length:stringLength encoding:NSUTF8StringEncoding];
+        if (!string) {
+            return NO;
+        }
+        [_strings addObject:string];
+        offset += stringLength;
+    }
+
+    _slots = header[3];
+    return offset == length;
+}
+
+/**
+ *  Check operands, jumps and stack use, so evaluation can't read or write out of bounds
+ */
+- (BOOL) verify
+{
+    const BLEExpressionInstruction *code = _code.bytes;
+    NSInteger count = (NSInteger)(_code.length / sizeof(BLEExpressionInstruction));
+    NSInteger numbersCount = (NSInteger)(_numbers.length / sizeof(double));
+    NSInteger stringsCount = (NSInteger)_strings.count;
+    NSInteger depth = 0;
+
+    // stack depth expected at jump targets, jumped and fall through paths has to agree
+    NSInteger *targetDepths = malloc((count + 1) * sizeof(NSInteger));
+    for (NSInteger i = 0; i <= count; i++) {
+        targetDepths[i] = -1;
+    }
+    BOOL valid = [self verifyCode:code count:count numbersCount:numbersCount stringsCount:stringsCount targetDepths:targetDepths depth:&depth];
+    if (valid && targetDepths[count] >= 0 && targetDepths[count] != depth) {
+        valid = NO;
+    }
+    free(targetDepths);
+    return valid;
+}
+
+- (BOOL) verifyCode:(const BLEExpressionInstruction *)code count:(NSInteger)count numbersCount:(NSInteger)numbersCount stringsCount:(NSInteger)stringsCount targetDepths:(NSInteger *)targetDepths depth:(NSInteger *)depthPointer
+{
+    NSInteger depth = 0;
+    for (NSInteger pc = 0; pc < count; pc++) {
+        if (targetDepths[pc] >= 0 && targetDepths[pc] != depth) {
+            return NO;
+        }
+
+        BLEExpressionInstruction instruction = code[pc];
+        NSInteger pops = 0, pushes = 0;
+        switch (instruction.op) {
+            case BLEExpressionOpPush:
+                if (instruction.arg < 0 || instruction.arg >= numbersCount) {
+                    return NO;
+                }
+                pushes = 1;
+                break;
+            case BLEExpressionOpLoad:
+                if (instruction.arg < 0 || instruction.arg >= BLEConditionExpressionSlotCount || BLEConditionExpressionSlotIsString(instruction.arg)) {
+                    return NO;
+                }
+                pushes = 1;
+                break;
+            case BLEExpressionOpIn:
+                if (instruction.arg < 0 || instruction.arg2 < 0 || instruction.arg > numbersCount - instruction.arg2) {
+                    return NO;
+                }
+                pops = pushes = 1;
+                break;
+            case BLEExpressionOpBetween:
+                if (instruction.arg < 0 || instruction.arg > numbersCount - 2) {
+                    return NO;
+                }
+                pops = pushes = 1;
+                break;
+            case BLEExpressionOpStringEqual:
+            case BLEExpressionOpStringNotEqual: {
+                int32_t operands[2] = {instruction.arg, instruction.arg2};
+                for (NSUInteger i = 0; i < 2; i++) {
+                    if (operands[i] >= 0 ? operands[i] >= stringsCount : (-(operands[i] + 1) >= BLEConditionExpressionSlotCount || !BLEConditionExpressionSlotIsString(-(operands[i] + 1)))) {
+                        return NO;
+                    }
+                }
+                pushes = 1;
+                break;
+            }
+            case BLEExpressionOpNegate:
+            case BLEExpressionOpNot:
+                pops = pushes = 1;
+                break;
+            case BLEExpressionOpJumpIfFalse:
+            case BLEExpressionOpJumpIfTrue:
+                // forward only, value is popped on fall through
+                if (instruction.arg <= pc || instruction.arg > count || depth < 1) {
+                    return NO;
+                }
+                if (targetDepths[instruction.arg] >= 0 && targetDepths[instruction.arg] != depth) {
+                    return NO;
+                }
+                targetDepths[instruction.arg] = depth;
+                pops = 1;
+                break;
+            case BLEExpressionOpAdd:
+            case BLEExpressionOpSubtract:
+            case BLEExpressionOpMultiply:
+            case BLEExpressionOpDivide:
+            case BLEExpressionOpEqual:
+            case BLEExpressionOpNotEqual:
+            case BLEExpressionOpLess:
+            case BLEExpressionOpLessOrEqual:
+            case BLEExpressionOpGreater:
+            case BLEExpressionOpGreaterOrEqual:
+                pops = 2;
+                pushes = 1;
+                break;
+            default:
+                return NO;
+        }
+
+        if (depth < pops) {
+            return NO;
+        }
+        depth += pushes - pops;
+        if (depth > BLEConditionExpressionMaxStack) {
+            return NO;
+        }
+    }
+    *depthPointer = depth;
+    return YES;
+}
+
+
+- (BOOL) usesSlot:(BLEConditionExpressionSlot)slot
+{
+    return (_slots & (1u << slot)) != 0;
+}
+
+#pragma mark - Evaluation
+
+static inline NSString *BLEConditionExpressionString(BLEConditionExpression *expression, __unsafe_unretained NSArray *strings, int32_t operand, __unsafe_unretained id <BLEConditionExpressionContext> context)
+{
+    if (operand >= 0) {
+        return strings[operand];
+    }
+    return [context conditionExpression:expression stringForSlot:-(operand + 1)];
+}
+
+- (BOOL) evaluateWithContext:(id <BLEConditionExpressionContext>)context
+{
+    double stack[BLEConditionExpressionMaxStack];
+    NSInteger sp = 0;
+
+    const BLEExpressionInstruction *code = _code.bytes;
+    const double *numbers = _numbers.bytes;
+    NSUInteger count = _code.length / sizeof(BLEExpressionInstruction);
+
+    NSUInteger pc = 0;
+    while (pc < count) {
+        const BLEExpressionInstruction *instruction = &code[pc++];
+        switch (instruction->op) {
+            case BLEExpressionOpPush:
+                stack[sp++] = numbers[instruction->arg];
+                break;
+            case BLEExpressionOpLoad:
+                stack[sp++] = [context conditionExpression:self numberForSlot:instruction->arg];
+                break;
+            case BLEExpressionOpAdd:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] + stack[sp];
+                break;
+            case BLEExpressionOpSubtract:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] - stack[sp];
+                break;
+            case BLEExpressionOpMultiply:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] * stack[sp];
+                break;
+            case BLEExpressionOpDivide:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] / stack[sp];
+                break;
+            case BLEExpressionOpNegate:
+                stack[sp - 1] = -stack[sp - 1];
+                break;
+            case BLEExpressionOpEqual:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] == stack[sp] ? 1 : 0;
+                break;
+            case BLEExpressionOpNotEqual:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] != stack[sp] ? 1 : 0;
+                break;
+            case BLEExpressionOpLess:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] < stack[sp] ? 1 : 0;
+                break;
+            case BLEExpressionOpLessOrEqual:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] <= stack[sp] ? 1 : 0;
+                break;
+            case BLEExpressionOpGreater:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] > stack[sp] ? 1 : 0;
+                break;
+            case BLEExpressionOpGreaterOrEqual:
+                sp--;
+                stack[sp - 1] = stack[sp - 1] >= stack[sp] ? 1 : 0;
+                break;
+            case BLEExpressionOpIn: {
+                double value = stack[sp - 1];
+                double result = 0;
+                for (int32_t i = 0; i < instruction->arg2; i++) {
+                    if (numbers[instruction->arg + i] == value) {
+                        result = 1;
+                        break;
+                    }
+                }
+                stack[sp - 1] = result;
+                break;
+            }
+            case BLEExpressionOpBetween:
+                stack[sp - 1] = (stack[sp - 1] >= numbers[instruction->arg] && stack[sp - 1] <= numbers[instruction->arg + 1]) ? 1 : 0;
+                break;
+            case BLEExpressionOpStringEqual:
+            case BLEExpressionOpStringNotEqual: {
+                NSString *string1 = BLEConditionExpressionString(self, _strings, instruction->arg, context);
+                NSString *string2 = BLEConditionExpressionString(self, _strings, instruction->arg2, context);
+                BOOL equal = (string1 == string2) || [string1 isEqualToString:string2];
+                stack[sp++] = (equal == (instruction->op == BLEExpressionOpStringEqual)) ? 1 : 0;
+                break;
+            }
+            case BLEExpressionOpNot:
+                stack[sp - 1] = stack[sp - 1] != 0 ? 0 : 1;
+                break;
+            case BLEExpressionOpJumpIfFalse:
+                if (stack[sp - 1] == 0) {
+                    pc = instruction->arg;
+                } else {
+                    sp--;
+                }
+                break;
+            case BLEExpressionOpJumpIfTrue:
+                if (stack[sp - 1] != 0) {
+                    pc = instruction->arg;
+                } else {
+                    sp--;
+                }
+                break;
+        }
+    }
+
+    return sp > 0 && stack[sp - 1] != 0;
+}
+
+#pragma mark - Code generation
+
+- (NSUInteger) emit:(BLEExpressionOp)op arg:(int32_t)arg arg2:(int32_t)arg2
+{
+    BLEExpressionInstruction instruction = {op, arg, arg2};
+    NSUInteger index = _code.length / sizeof(BLEExpressionInstruction);
+    [_code appendBytes:&instruction length:sizeof(instruction)];
+
+    switch (op) {
+        case BLEExpressionOpPush:
+        case BLEExpressionOpStringEqual:
+        case BLEExpressionOpStringNotEqual:
+            _depth++;
+            break;
+        case BLEExpressionOpLoad:
+            _slots |= 1u << arg;
+            _depth++;
+            break;
+        case BLEExpressionOpNegate:
+        case BLEExpressionOpNot:
+        case BLEExpressionOpIn:
+        case BLEExpressionOpBetween:
+            break;
+        default:
+            // binary operators and conditional jumps (on fall through)
+            _depth--;
+            break;
+    }
+    _maxDepth = MAX(_maxDepth, _depth);
+    return index;
+}
+
+- (void) patchJump:(NSUInteger)index
+{
+    BLEExpressionInstruction *code = _code.mutableBytes;
+    code[index].arg = (int32_t)(_code.length / sizeof(BLEExpressionInstruction));
+}
+
+- (int32_t) addNumber:(double)number
+{
+    int32_t index = (int32_t)(_numbers.length / sizeof(double));
+    [_numbers appendBytes:&number length:sizeof(number)];
+    return index;
+}
+
+- (int32_t) stringOperandForConstant:(NSString *)string
+{
+    [_strings addObject:string];
+    return (int32_t)_strings.count - 1;
+}
+
+- (int32_t) stringOperandForSlot:(BLEConditionExpressionSlot)slot
+{
+    _slots |= 1u << slot;
+    return -((int32_t)slot + 1);
+}
+
+- (BOOL) failWithCode:(BLEConditionExpressionError)code reason:(NSString *)reason
+{
+    if (!_error) {
+        NSUInteger position = [self currentToken].position;
+        NSString *description = [NSString stringWithFormat:@"%@ at position %@ in expression '%@'", reason, @(position), self.source];
+        _error = [NSError errorWithDomain:BLEErrorDomain code:code userInfo:@{NSLocalizedDescriptionKey: description}];
+    }
+    return NO;
+}
+
+#pragma mark - Tokenizer
+
+- (NSArray *) tokenize:(NSString *)string
+{
+    NSUInteger length = string.length;
+    unichar *characters = malloc((length + 1) * sizeof(unichar));
+    [string getCharacters:characters range:NSMakeRange(0, length)];
+    characters[length] = 0;
+
+    NSCharacterSet *identifierCharacters = [NSCharacterSet characterSetWithCharactersInString:@"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_."];
+    NSArray *operators = @[@"==", @"!=", @"<>", @"<=", @"=<", @">=", @"=>", @"&&", @"||", @"=", @"<", @">", @"!", @"+", @"-", @"*", @"/", @"(", @")", @"{", @"}", @","];
+
+    NSMutableArray *tokens = [NSMutableArray array];
+    NSUInteger i = 0;
+    BOOL success = YES;
+    while (success && i < length) {
+        unichar c = characters[i];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            i++;
+            continue;
+        }
+
+        BLEConditionExpressionToken *token = [[BLEConditionExpressionToken alloc] init];
+        token.position = i;
+
+        if ((c >= '0' && c <= '9') || (c == '.' && characters[i + 1] >= '0' && characters[i + 1] <= '9')) {
+            NSUInteger start = i;
+            while (characters[i] >= '0' && characters[i] <= '9') i++;
+            if (characters[i] == '.') {
+                i++;
+                while (characters[i] >= '0' && characters[i] <= '9') i++;
+            }
+            if (characters[i] == 'e' || characters[i] == 'E') {
+                NSUInteger exponent = i + 1;
+                if (characters[exponent] == '+' || characters[exponent] == '-') exponent++;
+                if (characters[exponent] >= '0' && characters[exponent] <= '9') {
+                    i = exponent;
+                    while (characters[i] >= '0' && characters[i] <= '9') i++;
+                }
+            }
+            token.type = BLEExpressionTokenNumber;
+            token.text = [string substringWithRange:NSMakeRange(start, i - start)];
+            token.number = [token.text doubleValue];
+        } else if (c == '"' || c == '\'') {
+            NSMutableString *text = [NSMutableString string];
+            i++;
+            while (i < length && characters[i] != c) {
+                unichar ch = characters[i++];
+                if (ch == '\\' && i < length) {
+                    ch = characters[i++];
+                    if (ch == 'n') ch = '\n';
+                    else if (ch == 't') ch = '\t';
+                }
+                [text appendFormat:@"%C", ch];
+            }
+            if (i >= length) {
+                success = [self failAtPosition:token.position reason:@"Unterminated string"];
+                break;
+            }
+            i++;
+            token.type = BLEExpressionTokenString;
+            token.text = text;
+        } else if (c == '$' || [identifierCharacters characterIsMember:c]) {
+            BOOL variable = c == '$';
+            NSUInteger start = variable ? i + 1 : i;
+            i = start;
+            while (i < length && [identifierCharacters characterIsMember:characters[i]]) i++;
+            token.type = variable ? BLEExpressionTokenVariable : BLEExpressionTokenIdentifier;
+            token.text = [string substringWithRange:NSMakeRange(start, i - start)];
+        } else {
+            for (NSString *operator in operators) {
+                if (i + operator.length <= length && [string compare:operator options:NSLiteralSearch range:NSMakeRange(i, operator.length)] == NSOrderedSame) {
+                    token.type = BLEExpressionTokenOperator;
+                    token.text = operator;
+                    i += operator.length;
+                    break;
+                }
+            }
+            if (!token.text) {
+                success = [self failAtPosition:i reason:[NSString stringWithFormat:@"Unsupported character '%C'", c]];
+                break;
+            }
+        }
+        [tokens addObject:token];
+    }
+    free(characters);
+
+    if (!success) {
+        return nil;
+    }
+
+    BLEConditionExpressionToken *end = [[BLEConditionExpressionToken alloc] init];
+    end.type = BLEExpressionTokenEnd;
+    end.position = length;
+    [tokens addObject:end];
+    return [tokens copy];
+}
+
+- (BOOL) failAtPosition:(NSUInteger)position reason:(NSString *)reason
+{
+    NSString *description = [NSString stringWithFormat:@"%@ at position %@ in expression '%@'", reason, @(position), self.source];
+    _error = [NSError errorWithDomain:BLEErrorDomain code:BLEConditionExpressionErrorSyntax userInfo:@{NSLocalizedDescriptionKey: description}];
+    return NO;
+}
+
+- (BLEConditionExpressionToken *) currentToken
+{
+    return _tokenIndex < _tokens.count ? _tokens[_tokenIndex] : nil;
+}
+
+/**
+ *  Consume operator or keyword (case insensitive) if it's current token
+ */
+- (BOOL) matchOperator:(NSString *)operator
+{
+    BLEConditionExpressionToken *token = [self currentToken];
+    if (token.type == BLEExpressionTokenOperator && [token.text isEqualToString:operator]) {
+        _tokenIndex++;
+        return YES;
+    }
+    return NO;
+}
+
+- (BOOL) matchKeyword:(NSString *)keyword
+{
+    BLEConditionExpressionToken *token = [self currentToken];
+    if (token.type == BLEExpressionTokenIdentifier && [token.text caseInsensitiveCompare:keyword] == NSOrderedSame) {
+        _tokenIndex++;
+        return YES;
+    }
+    return NO;
+}
+
+#pragma mark - Parser
+
+- (BOOL) parseOr:(BLEExpressionValue *)value
+{
+    if (![self parseAnd:value]) {
+        return NO;
+    }
+
+    while ([self matchOperator:@"||"] || [self matchKeyword:@"OR"]) {
+        if (value->type != BLEExpressionTypeBool) {
+            return [self failWithCode:BLEConditionExpressionErrorType reason:@"OR operand is not a predicate"];
+        }
+        NSUInteger jump = [self emit:BLEExpressionOpJumpIfTrue arg:0 arg2:0];
+        BLEExpressionValue right;
+        if (![self parseAnd:&right]) {
+            return NO;
+        }
+        if (right.type != BLEExpressionTypeBool) {
+            return [self failWithCode:BLEConditionExpressionErrorType reason:@"OR operand is not a predicate"];
+        }
+        [self patchJump:jump];
+    }
+    return YES;
+}
+
+- (BOOL) parseAnd:(BLEExpressionValue *)value
+{
+    if (![self parseNot:value]) {
+        return NO;
+    }
+
+    while ([self matchOperator:@"&&"] || [self matchKeyword:@"AND"]) {
+        if (value->type != BLEExpressionTypeBool) {
+            return [self failWithCode:BLEConditionExpressionErrorType reason:@"AND operand is not a predicate"];
+        }
+        NSUInteger jump = [self emit:BLEExpressionOpJumpIfFalse arg:0 arg2:0];
+        BLEExpressionValue right;
+        if (![self parseNot:&right]) {
+            return NO;
+        }
+        if (right.type != BLEExpressionTypeBool) {
+            return [self failWithCode:BLEConditionExpressionErrorType reason:@"AND operand is not a predicate"];
+        }
+        [self patchJump:jump];
+    }
+    return YES;
+}
+
+- (BOOL) parseNot:(BLEExpressionValue *)value
+{
+    if ([self matchOperator:@"!"] || [self matchKeyword:@"NOT"]) {
+        if (![self parseNot:value]) {
+            return NO;
+        }
+        if (value->type != BLEExpressionTypeBool) {
+            return [self failWithCode:BLEConditionExpressionErrorType reason:@"NOT operand is not a predicate"];
+        }
+        [self emit:BLEExpressionOpNot arg:0 arg2:0];
+        return YES;
+    }
+    return [self parseComparison:value];
+}
+
+- (BOOL) parseComparison:(BLEExpressionValue *)value
+{
+    if (![self parseAdditive:value]) {
+        return NO;
+    }
+
+    static NSDictionary *comparisonOperators = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        comparisonOperators = @{@"=": @(BLEExpressionOpEqual),
+                                @"==": @(BLEExpressionOpEqual),
+                                @"!=": @(BLEExpressionOpNotEqual),
+                                @"<>": @(BLEExpressionOpNotEqual),
+                                @"<": @(BLEExpressionOpLess),
+                                @"<=": @(BLEExpressionOpLessOrEqual),
+                                @"=<": @(BLEExpressionOpLessOrEqual),
+                                @">": @(BLEExpressionOpGreater),
+                                @">=": @(BLEExpressionOpGreaterOrEqual),
+                                @"=>": @(BLEExpressionOpGreaterOrEqual)};
+    });
+
+    BLEConditionExpressionToken *token = [self currentToken];
+    NSNumber *comparison = token.type == BLEExpressionTokenOperator ? comparisonOperators[token.text] : nil;
+    if (comparison) {
+        _tokenIndex++;
+        BLEExpressionOp op = [comparison unsignedCharValue];
+
+        BLEExpressionValue right;
+        if (![self parseAdditive:&right]) {
+            return NO;
+        }
+
+        if (value->type == BLEExpressionTypeString && right.type == BLEExpressionTypeString) {
+            if (op != BLEExpressionOpEqual && op != BLEExpressionOpNotEqual) {
+                return [self failWithCode:BLEConditionExpressionErrorUnsupported reason:@"Unsupported string comparison"];
+            }
+            [self emit:op == BLEExpressionOpEqual ? BLEExpressionOpStringEqual : BLEExpressionOpStringNotEqual arg:value->stringOperand arg2:right.stringOperand];
+        } else if (value->type == BLEExpressionTypeNumber && right.type == BLEExpressionTypeNumber) {
+            [self emit:op arg:0 arg2:0];
+        } else if (value->type == BLEExpressionTypeBool && right.type == BLEExpressionTypeBool && (op == BLEExpressionOpEqual || op == BLEExpressionOpNotEqual)) {
+            [self emit:op arg:0 arg2:0];
+        } else {
+            return [self failWithCode:BLEConditionExpressionErrorType reason:@"Incompatible types in comparison"];
+        }
+        value->type = BLEExpressionTypeBool;
+    } else if ([self matchKeyword:@"IN"] || (token.type == BLEExpressionTokenIdentifier && [token.text caseInsensitiveCompare:@"BETWEEN"] == NSOrderedSame)) {
+        BOOL between = [self matchKeyword:@"BETWEEN"];
+        if (value->type != BLEExpressionTypeNumber) {
+            return [self failWithCode:BLEConditionExpressionErrorType reason:@"IN and BETWEEN are supported for numbers only"];
+        }
+
+        int32_t first = (int32_t)(_numbers.length / sizeof(double));
+        int32_t count = 0;
+        if (![self matchOperator:@"{"]) {
+            return [self failWithCode:BLEConditionExpressionErrorSyntax reason:@"Expected '{'"];
+        }
+        do {
+            BOOL negative = [self matchOperator:@"-"];
+            BLEConditionExpressionToken *numberToken = [self currentToken];
+            if (numberToken.type != BLEExpressionTokenNumber) {
+                return [self failWithCode:BLEConditionExpressionErrorUnsupported reason:@"Expected number"];
+            }
+            _tokenIndex++;
+            [self addNumber:negative ? -numberToken.number : numberToken.number];
+            count++;
+        } while ([self matchOperator:@","]);
+        if (![self matchOperator:@"}"]) {
+            return [self failWithCode:BLEConditionExpressionErrorSyntax reason:@"Expected '}'"];
+        }
+
+        if (between) {
+            if (count != 2) {
+                return [self failWithCode:BLEConditionExpressionErrorSyntax reason:@"BETWEEN expects two values"];
+            }
+            [self emit:BLEExpressionOpBetween arg:first arg2:0];
+        } else {
+            [self emit:BLEExpressionOpIn arg:first arg2:count];
+        }
+        value->type = BLEExpressionTypeBool;
+    }
+
+    if (_maxDepth > BLEConditionExpressionMaxStack) {
+        return [self failWithCode:BLEConditionExpressionErrorUnsupported reason:@"Expression is too complex"];
+    }
+    return YES;
+}
+
+- (BOOL) parseAdditive:(BLEExpressionValue *)value
+{
+    if (![self parseMultiplicative:value]) {
+        return NO;
+    }
+
+    while (YES) {
+        BLEExpressionOp op;
+        if ([self matchOperator:@"+"]) {
+            op = BLEExpressionOpAdd;
+        } else if ([self matchOperator:@"-"]) {
+            op = BLEExpressionOpSubtract;
+        } else {
+            break;
+        }
+
+        BLEExpressionValue right;
+        if (![self parseMultiplicative:&right]) {
+            return NO;
+        }
+        if (value->type != BLEExpressionTypeNumber || right.type != BLEExpressionTypeNumber) {
+            return [self failWithCode:BLEConditionExpressionErrorType reason:@"Arithmetic operand is not a number"];
+        }
+        [self emit:op arg:0 arg2:0];
+    }
+    return YES;
+}
+
+- (BOOL) parseMultiplicative:(BLEExpressionValue *)value
+{
+    if (![self parseUnary:value]) {
+        return NO;
+    }
+
+    while (YES) {
+        BLEExpressionOp op;
+        if ([self matchOperator:@"*"]) {
+            op = BLEExpressionOpMultiply;
+        } else if ([self matchOperator:@"/"]) {
+            op = BLEExpressionOpDivide;
+        } else {
+            break;
+        }
+
+        BLEExpressionValue right;
+        if (![self parseUnary:&right]) {
+            return NO;
+        }
+        if (value->type != BLEExpressionTypeNumber || right.type != BLEExpressionTypeNumber) {
+            return [self failWithCode:BLEConditionExpressionErrorType reason:@"Arithmetic operand is not a number"];
+        }
+        [self emit:op arg:0 arg2:0];
+    }
+    return YES;
+}
+
+- (BOOL) parseUnary:(BLEExpressionValue *)value
+{
+    if ([self matchOperator:@"-"]) {
+        if (![self parseUnary:value]) {
+            return NO;
+        }
+        if (value->type != BLEExpressionTypeNumber) {
+            return [self failWithCode:BLEConditionExpressionErrorType reason:@"Arithmetic operand is not a number"];
+        }
+        [self emit:BLEExpressionOpNegate arg:0 arg2:0];
+        return YES;
+    }
+    return [self parsePrimary:value];
+}
+
+- (BOOL) parsePrimary:(BLEExpressionValue *)value
+{
+    BLEConditionExpressionToken *token = [self currentToken];
+    switch (token.type) {
+        case BLEExpressionTokenNumber:
+            _tokenIndex++;
+            [self emit:BLEExpressionOpPush arg:[self addNumber:token.number] arg2:0];
+            value->type = BLEExpressionTypeNumber;
+            return YES;
+        case BLEExpressionTokenString:
+            _tokenIndex++;
+            value->type = BLEExpressionTypeString;
+            value->stringOperand = [self stringOperandForConstant:token.text];
+            return YES;
+        case BLEExpressionTokenVariable: {
+            NSNumber *slot = BLEConditionExpressionVariables[token.text];
+            NSNumber *constant = BLEConditionExpressionConstants[token.text];
+            if (slot) {
+                [self emit:BLEExpressionOpLoad arg:[slot intValue] arg2:0];
+            } else if (constant) {
+                [self emit:BLEExpressionOpPush arg:[self addNumber:[constant doubleValue]] arg2:0];
+            } else {
+                return [self failWithCode:BLEConditionExpressionErrorUnknownIdentifier reason:[NSString stringWithFormat:@"Unknown variable '$%@'", token.text]];
+            }
+            _tokenIndex++;
+            value->type = BLEExpressionTypeNumber;
+            return YES;
+        }
+        case BLEExpressionTokenIdentifier: {
+            NSString *text = token.text;
+            if ([text caseInsensitiveCompare:@"TRUEPREDICATE"] == NSOrderedSame || [text caseInsensitiveCompare:@"YES"] == NSOrderedSame || [text caseInsensitiveCompare:@"TRUE"] == NSOrderedSame) {
+                _tokenIndex++;
+                [self emit:BLEExpressionOpPush arg:[self addNumber:1] arg2:0];
+                value->type = BLEExpressionTypeBool;
+                return YES;
+            }
+            if ([text caseInsensitiveCompare:@"FALSEPREDICATE"] == NSOrderedSame || [text caseInsensitiveCompare:@"NO"] == NSOrderedSame || [text caseInsensitiveCompare:@"FALSE"] == NSOrderedSame) {
+                _tokenIndex++;
+                [self emit:BLEExpressionOpPush arg:[self addNumber:0] arg2:0];
+                value->type = BLEExpressionTypeBool;
+                return YES;
+            }
+
+            NSNumber *slotNumber = BLEConditionExpressionKeyPaths[text];
+            if (!slotNumber) {
+                return [self failWithCode:BLEConditionExpressionErrorUnknownIdentifier reason:[NSString stringWithFormat:@"Unknown key path '%@'", text]];
+            }
+            _tokenIndex++;
+
+            BLEConditionExpressionSlot slot = [slotNumber integerValue];
+            if (BLEConditionExpressionSlotIsString(slot)) {
+                value->type = BLEExpressionTypeString;
+                value->stringOperand = [self stringOperandForSlot:slot];
+            } else {
+                [self emit:BLEExpressionOpLoad arg:(int32_t)slot arg2:0];
+                value->type = BLEExpressionTypeNumber;
+            }
+            return YES;
+        }
+        case BLEExpressionTokenOperator:
+            if ([self matchOperator:@"("]) {
+                if (![self parseOr:value]) {
+                    return NO;
+                }
+                if (![self matchOperator:@")"]) {
+                    return [self failWithCode:BLEConditionExpressionErrorSyntax reason:@"Expected ')'"];
+                }
+                return YES;
+            }
+            return [self failWithCode:BLEConditionExpressionErrorSyntax reason:[NSString stringWithFormat:@"Unexpected '%@'", token.text]];
+        case BLEExpressionTokenEnd:
+            return [self failWithCode:BLEConditionExpressionErrorSyntax reason:@"Unexpected end of expression"];
+    }
+    return NO;
+}
+
+@end
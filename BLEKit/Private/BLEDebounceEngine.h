@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+@class BLEBeacon;
+
+/**
+ *  Default delay of debounced event, in seconds
+ */
+#define BLEDebounceDefaultDelay 15
+/**
+ *  Events due within this interval are fired together
+ */
+#define BLEDebounceCoalesceInterval 0.5
+
+/**
+ *  Beacon parameter with delay of debounced event, in seconds
+ */
+static NSString * const BLEDebounceDelayParameterKey = @"leave_delay";
+
+/**
+ *  Debounce delayed events for beacons. Used to delay 'leave' action.
+ *
+ *  Pending events are kept in min-heap ordered by monotonic deadline and driven by single timer
+ *  armed for the earliest one. Events due together are fired in one batch. One background task
+ *  is held while any event is pending.
+ *
+ *  Delay is resolved in order: beacon override, beacon parameter BLEDebounceDelayParameterKey,
+ *  zone override, default delay.
+ *
+ *  Use from main queue only.
+ */
+@interface BLEDebounceEngine : NSObject
+
+/**
+ *  Delay used when there is no override. Default BLEDebounceDefaultDelay.
+ */
+@property (assign) NSTimeInterval defaultDelay;
+
+/**
+ *  Set delay for beacons of zone
+ *
+ *  @param delay      Delay in seconds, negative value removes override
+ *  @param identifier Zone identifier
+ */
+- (void) setDelay:(NSTimeInterval)delay forZoneIdentifier:(NSString *)identifier;
+
+/**
+ *  Set delay for beacon
+ *
+ *  @param delay  Delay in seconds, negative value removes override
+ *  @param beacon Beacon
+ */
+- (void) setDelay:(NSTimeInterval)delay forBeacon:(BLEBeacon *)beacon;
+
+/**
+ *  Resolve delay for beacon
+ *
+ *  @param beacon Beacon
+ *
+ *  @return Delay in seconds
+ */
+- (NSTimeInterval) delayForBeacon:(BLEBeacon *)beacon;
+
+/**
+ *  Schedule event after delay resolved for beacon, replacing event already scheduled for beacon.
+ *
+ *  @param beacon   Beacon
+ *  @param callback On time callback block
+ */
+- (void) scheduleEventForBeacon:(BLEBeacon *)beacon onTime:(void(^)(BLEBeacon *beacon))callback;
+
+/**
+ *  Schedule event, replacing event already scheduled for beacon.
+ *
+ *  @param beacon   Beacon
+ *  @param delay    Delay value in seconds
+ *  @param callback On time callback block
+ */
+- (void) scheduleEventForBeacon:(BLEBeacon *)beacon afterDelay:(NSTimeInterval)delay onTime:(void(^)(BLEBeacon *beacon))callback;
+
+/**
+ *  Cancel scheduled event
+ *
+ *  @param beacon beacon
+ *
+ *  @return YES if cancelled, NO if nothing was scheduled.
+ */
+- (BOOL) cancelForBeacon:(BLEBeacon *)beacon;
+
+/**
+ *  Cancel all scheduled events
+ */
+- (void) cancelAll;
+
+@end
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+#import "BLEDebounceEngine.h"
+#import "BLEKitPrivate.h"
+#import "BLEMonotonicClock.h"
+
+/**
+ *  Pending event
+ */
+@interface BLEDebounceEntry : NSObject
+@property (strong) BLEBeacon *beacon;
+@property (strong) BLEBeaconIdentity *identity;
+@property (copy) void (^callback)(BLEBeacon *beacon);
+@property (assign) NSTimeInterval deadline;
+/**
+ *  Order of scheduling, keeps events with equal deadline in order
+ */
+@property (assign) uint64_t sequence;
+/**
+ *  Position in heap
+ */
+@property (assign) NSUInteger heapIndex;
+@end
+
+@implementation BLEDebounceEntry
+@end
+
+@implementation BLEDebounceEngine {
+    dispatch_source_t _timer;
+    /**
+     *  Min-heap of BLEDebounceEntry by deadline
+     */
+    NSMutableArray *_heap;
+    /**
+     *  BLEDebounceEntry for beacon identity
+     */
+    NSMutableDictionary *_entries;
+    NSMutableDictionary *_zoneDelays;
+    NSMutableDictionary *_beaconDelays;
+    uint64_t _sequence;
+    UIBackgroundTaskIdentifier _backgroundTaskIdentifier;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        self->_defaultDelay = BLEDebounceDefaultDelay;
+        self->_heap = [NSMutableArray array];
+        self->_entries = [NSMutableDictionary dictionary];
+        self->_zoneDelays = [NSMutableDictionary dictionary];
+        self->_beaconDelays = [NSMutableDictionary dictionary];
+        self->_backgroundTaskIdentifier = UIBackgroundTaskInvalid;
+
+        __weak typeof(self)selfWeak = self;
+        self->_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+        dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        dispatch_source_set_event_handler(_timer, ^{
+            [selfWeak handleTimer];
+        });
+        dispatch_resume(_timer);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_timer) {
+        dispatch_source_cancel(_timer);
+    }
+    [self endBackgroundTask];
+}
+
+#pragma mark - Delays
+
+- (void) setDelay:(NSTimeInterval)delay forZoneIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+
+    if (delay < 0) {
+        [_zoneDelays removeObjectForKey:identifier];
+    } else {
+        _zoneDelays[identifier] = @(delay);
+    }
+}
+
+- (void) setDelay:(NSTimeInterval)delay forBeacon:(BLEBeacon *)beacon
+{
+    NSParameterAssert(beacon);
+
+    // by identifier, so override survives zone reload
+    if (delay < 0) {
+        [_beaconDelays removeObjectForKey:beacon.identifier];
+    } else {
+        _beaconDelays[beacon.identifier] = @(delay);
+    }
+}
+
+- (NSTimeInterval) delayForBeacon:(BLEBeacon *)beacon
+{
+    NSNumber *delay = beacon.identifier ? _beaconDelays[beacon.identifier] : nil;
+    if (delay) {
+        return [delay doubleValue];
+    }
+
+    id parameter = beacon.parameters[BLEDebounceDelayParameterKey];
+    if ([parameter respondsToSelector:@selector(doubleValue)] && [parameter doubleValue] >= 0) {
+        return [parameter doubleValue];
+    }
+
+    NSString *zoneIdentifier = beacon.zone.identifier;
+    delay = zoneIdentifier ? _zoneDelays[zoneIdentifier] : nil;
+    if (delay) {
+        return [delay doubleValue];
+    }
+
+    return self.defaultDelay;
+}
+
+#pragma mark - Scheduling
+
+- (void) scheduleEventForBeacon:(BLEBeacon *)beacon onTime:(void(^)(BLEBeacon *beacon))callback
+{
+    [self scheduleEventForBeacon:beacon afterDelay:[self delayForBeacon:beacon] onTime:callback];
+}
+
+- (void) scheduleEventForBeacon:(BLEBeacon *)beacon afterDelay:(NSTimeInterval)delay onTime:(void(^)(BLEBeacon *beacon))callback
+{
+    NSParameterAssert(beacon);
+    NSParameterAssert(callback);
+
+    BLEBeaconIdentity *identity = [beacon beaconIdentity];
+    BLEDebounceEntry *entry = _entries[identity];
+    BOOL scheduled = entry != nil;
+    if (!scheduled) {
+        entry = [[BLEDebounceEntry alloc] init];
+        entry.identity = identity;
+    }
+    entry.beacon = beacon;
+    entry.callback = callback;
+    entry.deadline = BLEMonotonicTime() + MAX(0, delay);
+    entry.sequence = _sequence++;
+
+    if (scheduled) {
+        // delay may differ from previous one
+        [self siftDown:entry.heapIndex];
+        [self siftUp:entry.heapIndex];
+    } else {
+        _entries[identity] = entry;
+        entry.heapIndex = _heap.count;
+        [_heap addObject:entry];
+        [self siftUp:entry.heapIndex];
+        [self beginBackgroundTask];
+    }
+
+    [self arm];
+}
+
+- (BOOL) cancelForBeacon:(BLEBeacon *)beacon
+{
+    BLEBeaconIdentity *identity = [beacon beaconIdentity];
+    BLEDebounceEntry *entry = _entries[identity];
+    if (!entry) {
+        return NO;
+    }
+
+    [_entries removeObjectForKey:identity];
+    [self removeHeapEntry:entry];
+    [self arm];
+
+    if (_entries.count == 0) {
+        [self endBackgroundTask];
+    }
+    return YES;
+}
+
+- (void) cancelAll
+{
+    [_heap removeAllObjects];
+    [_entries removeAllObjects];
+    [self arm];
+    [self endBackgroundTask];
+}
+
+#pragma mark - Timer
+
+/**
+ *  Arm timer for the earliest deadline
+ */
+- (void) arm
+{
+    BLEDebounceEntry *first = _heap.firstObject;
+    if (!first) {
+        dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        return;
+    }
+
+    NSTimeInterval delay = MAX(0, first.deadline - BLEMonotonicTime());
+    dispatch_source_set_timer(_timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, (uint64_t)(BLEDebounceCoalesceInterval * NSEC_PER_SEC));
+}
+
+- (void) handleTimer
+{
+    // pop everything due, callbacks may schedule or cancel events
+    NSTimeInterval now = BLEMonotonicTime() + BLEDebounceCoalesceInterval;
+    NSMutableArray *batch = [NSMutableArray array];
+    while (_heap.count > 0 && [_heap[0] deadline] <= now) {
+        BLEDebounceEntry *entry = _heap[0];
+        [self removeHeapEntry:entry];
+        [_entries removeObjectForKey:entry.identity];
+        [batch addObject:entry];
+    }
+    [self arm];
+
+#ifdef DEBUG
+    if (batch.count > 0) {
+        NSLog(@"%@ Fire %@ events, %@ pending.", [self class], @(batch.count), @(_heap.count));
+    }
+#endif
+
+    for (BLEDebounceEntry *entry in batch) {
+        entry.callback(entry.beacon);
+    }
+
+    if (_entries.count == 0) {
+        [self endBackgroundTask];
+    }
+}
+
+#pragma mark - Background task
+
+- (void) beginBackgroundTask
+{
+    if (_backgroundTaskIdentifier != UIBackgroundTaskInvalid) {
+        return;
+    }
+
+    __weak typeof(self)selfWeak = self;
+    _backgroundTaskIdentifier = [[UIApplication sharedApplication] beginBackgroundTaskWithName:@"blekit-debounce" expirationHandler:^{
+#ifdef DEBUG
+        NSLog(@"Application about to suspend with %@ pending events", @([selfWeak pendingCount]));
+#endif
+        // must end synchronously, due events fire after resume
+        [selfWeak endBackgroundTask];
+    }];
+}
+
+- (void) endBackgroundTask
+{
+    if (_backgroundTaskIdentifier != UIBackgroundTaskInvalid) {
+        [[UIApplication sharedApplication] endBackgroundTask:_backgroundTaskIdentifier];
+        _backgroundTaskIdentifier = UIBackgroundTaskInvalid;
+    }
+}
+
+- (NSUInteger) pendingCount
+{
+    return _entries.count;
+}
+
+#pragma mark - Heap
+
+- (BOOL) entryAtIndex:(NSUInteger)a isBeforeEntryAtIndex:(NSUInteger)b
+{
+    BLEDebounceEntry *entryA = _heap[a];
+    BLEDebounceEntry *entryB = _heap[b];
+    if (entryA.deadline != entryB.deadline) {
+        return entryA.deadline < entryB.deadline;
+    }
+    return entryA.sequence < entryB.sequence;
+}
+
+- (void) swapEntryAtIndex:(NSUInteger)a withEntryAtIndex:(NSUInteger)b
+{
+    [_heap exchangeObjectAtIndex:a withObjectAtIndex:b];
+    [_heap[a] setHeapIndex:a];
+    [_heap[b] setHeapIndex:b];
+}
+
+- (void) siftUp:(NSUInteger)index
+{
+    while (index > 0) {
+        NSUInteger parent = (index - 1) / 2;
+        if (![self entryAtIndex:index isBeforeEntryAtIndex:parent]) {
+            break;
+        }
+        [self swapEntryAtIndex:index withEntryAtIndex:parent];
+        index = parent;
+    }
+}
+
+- (void) siftDown:(NSUInteger)index
+{
+    NSUInteger count = _heap.count;
+    while (YES) {
+        NSUInteger smallest = index;
+        NSUInteger left = 2 * index + 1;
+        NSUInteger right = left + 1;
+        if (left < count && [self entryAtIndex:left isBeforeEntryAtIndex:smallest]) {
+            smallest = left;
+        }
+        if (right < count && [self entryAtIndex:right isBeforeEntryAtIndex:smallest]) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        [self swapEntryAtIndex:index withEntryAtIndex:smallest];
+        index = smallest;
+    }
+}
+
+- (void) removeHeapEntry:(BLEDebounceEntry *)entry
+{
+    NSUInteger index = entry.heapIndex;
+    NSUInteger last = _heap.count - 1;
+    if (index != last) {
+        [self swapEntryAtIndex:index withEntryAtIndex:last];
+    }
+    [_heap removeLastObject];
+    if (index < _heap.count) {
+        [self siftDown:index];
+        [self siftUp:index];
+    }
+}
+
+@end
@@ -33,6 +33,8 @@
 #import "BLETrigger.h"
 #import "BLEAction.h"
 #import "BLECondition.h"
+#import "BLEBeaconKey.h"
+#import "BLEBeaconIdentity.h"
 
 #define UPN_ABSTRACT_METHOD {\
 [self doesNotRecognizeSelector:_cmd]; \
@@ -57,16 +59,75 @@ static NSString * const BLETriggerTypeRangeString = @"range";
 @end
 
 @interface BLEBeacon () <BLEUpdatableFromDictionary>
+/**
+ *  Identity of the beacon, cached until proximityUUID, major or minor changes
+ */
+- (BLEBeaconIdentity *) beaconIdentity;
+/**
+ *  Packed identity of the beacon
+ */
+- (BLEBeaconKey) beaconKey;
+/**
+ *  Set proximityUUID, major and minor from key
+ */
+- (void) setBeaconKey:(BLEBeaconKey)beaconKey;
+/**
+ *  Update from dictionary, invalid identifier is returned as error
+ *
+ *  @param dictionary Beacon definition
+ *  @param error      error or nil
+ *
+ *  @return YES on success
+ */
+- (BOOL) updatePropertiesFromDictionary:(NSDictionary *)dictionary error:(NSError * __autoreleasing *)error;
+/**
+ *  Triggers that can be valid for given event type. Index is rebuilt when triggers are set.
+ *
+ *  @param eventType event type
+ *
+ *  @return Array of triggers
+ */
+- (NSArray *) triggersForEventType:(BLEEventType)eventType;
 @end
 
 @interface BLELocation () <BLEUpdatableFromDictionary>
 @end
 
 @interface BLETrigger () <BLEUpdatableFromDictionary>
+/**
+ *  Event type all conditions can be valid for, BLEEventTypeUnknown if trigger can't be valid for any event.
+ */
+- (BLEEventType) eventType;
+/**
+ *  Slot of occurrence counter for trigger action and beacon
+ *  @see BLEOccurrenceStore
+ */
+- (NSUInteger) occurrenceSlot;
 @end
 
 @interface BLEAction () <BLEUpdatableFromDictionary>
 @end
 
+@class BLEConditionExpression;
+
 @interface BLECondition () <BLEUpdatableFromDictionary>
+/**
+ *  Natively compiled expression, nil if expression is not set or not supported natively
+ */
+- (BLEConditionExpression *) nativeExpression;
+/**
+ *  Natively compiled parameters, nil if parameters are not set or not supported natively
+ */
+- (BLEConditionExpression *) nativeParameters;
+- (BLEConditionExpression *) nativeParametersWithoutOccurrence;
+/**
+ *  Set properties with expressions compiled before, eg. loaded from zone snapshot.
+ *  Condition is compiled as usual if native expressions are missing.
+ */
+- (void) updateWithType:(NSString *)type
+             parameters:(NSDictionary *)parameters
+             expression:(NSString *)expression
+       nativeExpression:(BLEConditionExpression *)nativeExpression
+       nativeParameters:(BLEConditionExpression *)nativeParameters
+nativeParametersWithoutOccurrence:(BLEConditionExpression *)nativeParametersWithoutOccurrence;
 @end
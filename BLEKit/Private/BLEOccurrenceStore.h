@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+@class BLEStateFile;
+
+/**
+ *  Counter key for action of beacon
+ */
+#define BLECacheActionIdentifierFormat(action,beacon) \
+    [NSString stringWithFormat:@"beacon.%@.action.%@.type.%@", beacon.identifier, action.uniqueIdentifier, action.type]
+
+/**
+ *  Occurrence counters for actions.
+ *
+ *  Counters are counter records of state file, key is interned once to slot (record index).
+ *  @see BLEStateFile
+ */
+@interface BLEOccurrenceStore : NSObject
+
+/**
+ *  Shared store
+ */
++ (instancetype) sharedStore;
+
+/**
+ *  Initialize store with counters from state file
+ *
+ *  @param stateFile State file
+ *
+ *  @return Initialized object
+ */
+- (instancetype) initWithStateFile:(BLEStateFile *)stateFile;
+
+/**
+ *  Slot for counter key, created if needed. Slot is valid for lifetime of the store.
+ *
+ *  @param key Counter key
+ *
+ *  @return Slot
+ *  @see BLECacheActionIdentifierFormat
+ */
+- (NSUInteger) slotForKey:(NSString *)key;
+
+/**
+ *  Counter value
+ *
+ *  @param slot Slot
+ *
+ *  @return Value
+ */
+- (int64_t) valueAtSlot:(NSUInteger)slot;
+
+/**
+ *  Set counter value
+ *
+ *  @param value Value
+ *  @param slot  Slot
+ */
+- (void) setValue:(int64_t)value atSlot:(NSUInteger)slot;
+
+/**
+ *  Increment counter value
+ *
+ *  @param slot Slot
+ *
+ *  @return New value
+ */
+- (int64_t) incrementValueAtSlot:(NSUInteger)slot;
+
+/**
+ *  Write pending changes now. Blocks until written.
+ */
+- (void) synchronize;
+
+@end
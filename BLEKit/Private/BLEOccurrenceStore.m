@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEOccurrenceStore.h"
+#import "BLEStateFile.h"
+
+@implementation BLEOccurrenceStore {
+    BLEStateFile *_stateFile;
+}
+
++ (instancetype) sharedStore
+{
+    static BLEOccurrenceStore *sharedStore = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedStore = [[BLEOccurrenceStore alloc] initWithStateFile:[BLEStateFile sharedStateFile]];
+    });
+    return sharedStore;
+}
+
+- (instancetype) initWithStateFile:(BLEStateFile *)stateFile
+{
+    NSParameterAssert(stateFile);
+
+    if (self = [super init]) {
+        self->_stateFile = stateFile;
+    }
+    return self;
+}
+
+#pragma mark - Counters
+
+- (NSUInteger) slotForKey:(NSString *)key
+{
+    NSParameterAssert(key);
+    return [_stateFile recordForKey:key type:BLEStateRecordTypeCounter create:YES];
+}
+
+- (int64_t) valueAtSlot:(NSUInteger)slot
+{
+    return [_stateFile integerValueAtRecord:slot];
+}
+
+- (void) setValue:(int64_t)value atSlot:(NSUInteger)slot
+{
+    [_stateFile setIntegerValue:value atRecord:slot];
+}
+
+- (int64_t) incrementValueAtSlot:(NSUInteger)slot
+{
+    @synchronized(_stateFile) {
+        int64_t value = [_stateFile integerValueAtRecord:slot] + 1;
+        [_stateFile setIntegerValue:value atRecord:slot];
+        return value;
+    }
+}
+
+- (void) synchronize
+{
+    [_stateFile synchronize];
+}
+
+@end
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+#import <CoreLocation/CoreLocation.h>
+
+#import "BLEProximityFilter.h"
+
+/**
+ *  Accuracy boundaries of proximity classes, meters
+ */
+#define BLEProximityImmediateThreshold 0.5
+#define BLEProximityNearThreshold 3.0
+/**
+ *  Half width of hysteresis band around boundaries, meters
+ */
+#define BLEProximityImmediateHysteresis 0.1
+#define BLEProximityNearHysteresis 0.5
+/**
+ *  Filter is reset if beacon wasn't ranged for this interval
+ */
+#define BLEProximityFilterResetInterval 30
+
+@class BLEBeacon;
+
+typedef id <BLEProximityFilter> (^BLEProximityFilterFactory)(void);
+
+/**
+ *  Proximity of ranged beacons.
+ *
+ *  Accuracy of every beacon goes through its own filter, then it's classified with hysteresis
+ *  around class boundaries, so noisy samples don't flip proximity back and forth.
+ */
+@interface BLEProximityEstimator : NSObject
+
+/**
+ *  Creates filter for beacon. Default is moving median followed by Kalman filter.
+ */
+@property (copy) BLEProximityFilterFactory filterFactory;
+
+/**
+ *  Estimate proximity
+ *
+ *  @param beacon           Beacon, current proximity is used for hysteresis
+ *  @param accuracy         Ranged accuracy
+ *  @param time             Monotonic time of sample
+ *  @param filteredAccuracy Filtered accuracy or NULL
+ *
+ *  @return Proximity
+ */
+- (CLProximity) proximityForBeacon:(BLEBeacon *)beacon accuracy:(CLLocationAccuracy)accuracy time:(NSTimeInterval)time filteredAccuracy:(CLLocationAccuracy *)filteredAccuracy;
+
+/**
+ *  Forget filters of beacons not in set
+ */
+- (void) removeFiltersExceptBeacons:(NSSet *)beacons;
+
+/**
+ *  Classify accuracy. Boundary has to be crossed by hysteresis band to leave current proximity.
+ */
++ (CLProximity) proximityForAccuracy:(CLLocationAccuracy)accuracy currentProximity:(CLProximity)currentProximity;
+
+@end
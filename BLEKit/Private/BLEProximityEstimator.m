@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEProximityEstimator.h"
+#import "BLEKit.h"
+#import "BLEKitPrivate.h"
+
+/**
+ *  Filter of single beacon
+ */
+@interface BLEProximityEstimatorEntry : NSObject
+@property (strong) id <BLEProximityFilter> filter;
+@property (assign) NSTimeInterval time;
+@end
+
+@implementation BLEProximityEstimatorEntry
+@end
+
+@implementation BLEProximityEstimator {
+    NSMutableDictionary *_entries;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        self->_entries = [NSMutableDictionary dictionary];
+        self->_filterFactory = ^id <BLEProximityFilter> {
+            return [[BLEFilterChain alloc] initWithFilters:@[[[BLEMedianFilter alloc] initWithWindowSize:5], [[BLEKalmanFilter alloc] initWithProcessNoise:0.1 measurementNoise:1.0]]];
+        };
+    }
+    return self;
+}
+
+- (CLProximity) proximityForBeacon:(BLEBeacon *)beacon accuracy:(CLLocationAccuracy)accuracy time:(NSTimeInterval)time filteredAccuracy:(CLLocationAccuracy *)filteredAccuracy
+{
+    NSParameterAssert(beacon);
+
+    BLEBeaconIdentity *identity = [beacon beaconIdentity];
+    BLEProximityEstimatorEntry *entry = nil;
+    @synchronized(self) {
+        entry = _entries[identity];
+        if (!entry) {
+            entry = [[BLEProximityEstimatorEntry alloc] init];
+            entry.filter = self.filterFactory();
+            _entries[identity] = entry;
+        } else if (time - entry.time > BLEProximityFilterResetInterval) {
+            // old measurements are not relevant any more
+            [entry.filter reset];
+        }
+        entry.time = time;
+    }
+
+    CLLocationAccuracy filtered = [entry.filter filterValue:accuracy time:time];
+    if (filteredAccuracy) {
+        *filteredAccuracy = filtered;
+    }
+    return [[self class] proximityForAccuracy:filtered currentProximity:beacon.proximity];
+}
+
+- (void) removeFiltersExceptBeacons:(NSSet *)beacons
+{
+    NSMutableSet *identities = [NSMutableSet setWithCapacity:beacons.count];
+    for (BLEBeacon *beacon in beacons) {
+        [identities addObject:[beacon beaconIdentity]];
+    }
+
+    @synchronized(self) {
+        for (BLEBeaconIdentity *identity in [_entries allKeys]) {
+            if (![identities containsObject:identity]) {
+                [_entries removeObjectForKey:identity];
+            }
+        }
+    }
+}
+
++ (CLProximity) proximityForAccuracy:(CLLocationAccuracy)accuracy currentProximity:(CLProximity)currentProximity
+{
+    // boundaries are moved away from current proximity
+    CLLocationAccuracy immediateThreshold = BLEProximityImmediateThreshold;
+    CLLocationAccuracy nearThreshold = BLEProximityNearThreshold;
+    switch (currentProximity) {
+        case CLProximityImmediate:
+            immediateThreshold += BLEProximityImmediateHysteresis;
+            nearThreshold += BLEProximityNearHysteresis;
+            break;
+        case CLProximityNear:
+            immediateThreshold -= BLEProximityImmediateHysteresis;
+            nearThreshold += BLEProximityNearHysteresis;
+            break;
+        case CLProximityFar:
+            immediateThreshold -= BLEProximityImmediateHysteresis;
+            nearThreshold -= BLEProximityNearHysteresis;
+            break;
+        default:
+            break;
+    }
+
+    if (accuracy < immediateThreshold) {
+        return CLProximityImmediate;
+    } else if (accuracy <= nearThreshold) {
+        return CLProximityNear;
+    }
+    return CLProximityFar;
+}
+
+@end
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Filter of ranged values (accuracy) of single beacon
+ */
+@protocol BLEProximityFilter <NSObject>
+/**
+ *  Add measurement
+ *
+ *  @param value Measured value
+ *  @param time  Monotonic time of measurement
+ *
+ *  @return Filtered value
+ */
+- (double) filterValue:(double)value time:(NSTimeInterval)time;
+/**
+ *  Forget previous measurements
+ */
+- (void) reset;
+@end
+
+/**
+ *  Moving median, removes single outliers
+ */
+@interface BLEMedianFilter : NSObject <BLEProximityFilter>
+/**
+ *  @param windowSize Number of last measurements, at most 15
+ */
+- (instancetype) initWithWindowSize:(NSUInteger)windowSize;
+@end
+
+/**
+ *  One dimensional Kalman filter, constant value model
+ */
+@interface BLEKalmanFilter : NSObject <BLEProximityFilter>
+/**
+ *  @param processNoise     Variance of value change per second
+ *  @param measurementNoise Variance of measurement
+ */
+- (instancetype) initWithProcessNoise:(double)processNoise measurementNoise:(double)measurementNoise;
+@end
+
+/**
+ *  Filters applied in order
+ */
+@interface BLEFilterChain : NSObject <BLEProximityFilter>
+- (instancetype) initWithFilters:(NSArray *)filters;
+@end
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEProximityFilter.h"
+
+#define BLEMedianFilterMaxWindowSize 15
+
+@implementation BLEMedianFilter {
+    double _values[BLEMedianFilterMaxWindowSize];
+    NSUInteger _windowSize;
+    NSUInteger _count;
+    NSUInteger _next;
+}
+
+- (instancetype)init
+{
+    return [self initWithWindowSize:5];
+}
+
+- (instancetype) initWithWindowSize:(NSUInteger)windowSize
+{
+    if (self = [super init]) {
+        self->_windowSize = MAX(1, MIN(windowSize, BLEMedianFilterMaxWindowSize));
+    }
+    return self;
+}
+
+- (double) filterValue:(double)value time:(NSTimeInterval)time
+{
+    _values[_next] = value;
+    _next = (_next + 1) % _windowSize;
+    _count = MIN(_count + 1, _windowSize);
+
+    // insertion sort of small window
+    double sorted[BLEMedianFilterMaxWindowSize];
+    for (NSUInteger i = 0; i < _count; i++) {
+        double v = _values[i];
+        NSUInteger j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+
+    if (_count % 2) {
+        return sorted[_count / 2];
+    }
+    return (sorted[_count / 2 - 1] + sorted[_count / 2]) / 2;
+}
+
+- (void) reset
+{
+    _count = 0;
+    _next = 0;
+}
+
+@end
+
+@implementation BLEKalmanFilter {
+    double _processNoise;
+    double _measurementNoise;
+    double _estimate;
+    double _errorCovariance;
+    NSTimeInterval _time;
+    BOOL _initialized;
+}
+
+- (instancetype)init
+{
+    return [self initWithProcessNoise:0.1 measurementNoise:1.0];
+}
+
+- (instancetype) initWithProcessNoise:(double)processNoise measurementNoise:(double)measurementNoise
+{
+    if (self = [super init]) {
+        self->_processNoise = processNoise;
+        self->_measurementNoise = measurementNoise;
+    }
+    return self;
+}
+
+- (double) filterValue:(double)value time:(NSTimeInterval)time
+{
+    if (!_initialized) {
+        _estimate = value;
+        _errorCovariance = _measurementNoise;
+        _time = time;
+        _initialized = YES;
+        return _estimate;
+    }
+
+    // predict, uncertainty grows with time since last measurement
+    NSTimeInterval elapsed = MAX(time - _time, 0);
+    _time = time;
+    _errorCovariance += _processNoise * elapsed;
+
+    // update
+    double gain = _errorCovariance / (_errorCovariance + _measurementNoise);
+    _estimate += gain * (value - _estimate);
+    _errorCovariance *= (1 - gain);
+    return _estimate;
+}
+
+- (void) reset
+{
+    _initialized = NO;
+}
+
+@end
+
+@implementation BLEFilterChain {
+    NSArray *_filters;
+}
+
+- (instancetype) initWithFilters:(NSArray *)filters
+{
+    if (self = [super init]) {
+        self->_filters = [filters copy];
+    }
+    return self;
+}
+
+- (double) filterValue:(double)value time:(NSTimeInterval)time
+{
+    for (id <BLEProximityFilter> filter in _filters) {
+        value = [filter filterValue:value time:time];
+    }
+    return value;
+}
+
+- (void) reset
+{
+    for (id <BLEProximityFilter> filter in _filters) {
+        [filter reset];
+    }
+}
+
+@end
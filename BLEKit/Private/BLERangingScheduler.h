@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+#import <CoreLocation/CoreLocation.h>
+
+/**
+ *  Ranging window, ranging continues after window if proximity changed in it
+ */
+#define BLERangingSchedulerActiveInterval 5
+/**
+ *  Pause after first window with stable proximity, doubled up to max
+ */
+#define BLERangingSchedulerMinIdleInterval 2
+#define BLERangingSchedulerMaxIdleInterval 30
+
+@class BLERangingScheduler;
+
+@protocol BLERangingSchedulerDelegate <NSObject>
+- (void) rangingScheduler:(BLERangingScheduler *)scheduler startRangingBeaconsInRegion:(CLBeaconRegion *)region;
+- (void) rangingScheduler:(BLERangingScheduler *)scheduler stopRangingBeaconsInRegion:(CLBeaconRegion *)region;
+@end
+
+/**
+ *  Duty cycle of ranging.
+ *
+ *  Region is ranged only while device is inside and ranging is demanded (beacons with range triggers).
+ *  Ranging runs in windows, pause between windows grows while proximity is stable and is reset on change.
+ *  Must be used from main thread.
+ */
+@interface BLERangingScheduler : NSObject
+
+@property (weak) id <BLERangingSchedulerDelegate> delegate;
+/**
+ *  Total time of ranging, all regions
+ */
+@property (assign, readonly) NSTimeInterval rangingTimeInterval;
+/**
+ *  Number of started ranging windows
+ */
+@property (assign, readonly) NSUInteger rangingWindowsCount;
+/**
+ *  Number of pauses because of stable proximity
+ */
+@property (assign, readonly) NSUInteger backoffsCount;
+
+- (instancetype) initWithDelegate:(id <BLERangingSchedulerDelegate>)delegate;
+
+/**
+ *  Set if region should be ranged while inside
+ */
+- (void) setDemanded:(BOOL)demanded forRegionIdentifier:(NSString *)identifier;
+
+/**
+ *  Set region state
+ */
+- (void) setInside:(BOOL)inside forRegion:(CLBeaconRegion *)region;
+
+/**
+ *  Proximity changed in region, ranging is ramped up
+ */
+- (void) activityInRegionWithIdentifier:(NSString *)identifier;
+
+/**
+ *  Stop ranging and forget region
+ */
+- (void) removeRegionWithIdentifier:(NSString *)identifier;
+- (void) removeAllRegions;
+
+@end
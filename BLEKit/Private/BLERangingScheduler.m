@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLERangingScheduler.h"
+#import "BLEMonotonicClock.h"
+
+/**
+ *  Ranging state of single region
+ */
+@interface BLERangingSchedulerRegion : NSObject
+@property (strong) CLBeaconRegion *region;
+@property (assign) BOOL demanded;
+@property (assign) BOOL inside;
+@property (assign) BOOL ranging;
+@property (assign) NSTimeInterval rangingStartTime;
+@property (assign) NSTimeInterval idleInterval;
+@property (assign) BOOL changed;
+/**
+ *  Incremented on every state change, scheduled blocks of previous generation are ignored
+ */
+@property (assign) NSUInteger generation;
+@end
+
+@implementation BLERangingSchedulerRegion
+@end
+
+@implementation BLERangingScheduler {
+    NSMutableDictionary *_regions;
+}
+
+- (instancetype) initWithDelegate:(id <BLERangingSchedulerDelegate>)delegate
+{
+    if (self = [super init]) {
+        self->_delegate = delegate;
+        self->_regions = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+#ifdef DEBUG
+    NSLog(@"%@ ranging %.1f s in %@ windows, %@ backoffs", self, self.rangingTimeInterval, @(self.rangingWindowsCount), @(self.backoffsCount));
+#endif
+}
+
+- (BLERangingSchedulerRegion *) stateForRegionIdentifier:(NSString *)identifier
+{
+    BLERangingSchedulerRegion *state = _regions[identifier];
+    if (!state) {
+        state = [[BLERangingSchedulerRegion alloc] init];
+        state.idleInterval = BLERangingSchedulerMinIdleInterval;
+        _regions[identifier] = state;
+    }
+    return state;
+}
+
+#pragma mark - Public
+
+- (void) setDemanded:(BOOL)demanded forRegionIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+
+    BLERangingSchedulerRegion *state = [self stateForRegionIdentifier:identifier];
+    if (state.demanded != demanded) {
+        state.demanded = demanded;
+        [self updateState:state];
+    }
+}
+
+- (void) setInside:(BOOL)inside forRegion:(CLBeaconRegion *)region
+{
+    NSParameterAssert(region);
+
+    BLERangingSchedulerRegion *state = [self stateForRegionIdentifier:region.identifier];
+    state.region = region;
+    if (state.inside != inside) {
+        state.inside = inside;
+        [self updateState:state];
+    }
+}
+
+- (void) activityInRegionWithIdentifier:(NSString *)identifier
+{
+    BLERangingSchedulerRegion *state = identifier ? _regions[identifier] : nil;
+    if (!state) {
+        return;
+    }
+
+    state.changed = YES;
+    state.idleInterval = BLERangingSchedulerMinIdleInterval;
+    if (!state.ranging && state.demanded && state.inside && state.region) {
+        [self startWindow:state];
+    }
+}
+
+- (void) removeRegionWithIdentifier:(NSString *)identifier
+{
+    BLERangingSchedulerRegion *state = identifier ? _regions[identifier] : nil;
+    if (state) {
+        [self stopRanging:state];
+        state.generation++;
+        [_regions removeObjectForKey:identifier];
+    }
+}
+
+- (void) removeAllRegions
+{
+    for (NSString *identifier in [_regions allKeys]) {
+        [self removeRegionWithIdentifier:identifier];
+    }
+}
+
+#pragma mark - Duty cycle
+
+- (void) updateState:(BLERangingSchedulerRegion *)state
+{
+    state.generation++;
+    if (state.demanded && state.inside && state.region) {
+        state.idleInterval = BLERangingSchedulerMinIdleInterval;
+        [self startWindow:state];
+    } else {
+        [self stopRanging:state];
+    }
+}
+
+- (void) startWindow:(BLERangingSchedulerRegion *)state
+{
+    state.changed = NO;
+    if (!state.ranging) {
+        state.ranging = YES;
+        state.rangingStartTime = BLEMonotonicTime();
+        self->_rangingWindowsCount++;
+        [self.delegate rangingScheduler:self startRangingBeaconsInRegion:state.region];
+    }
+    __weak typeof(self)selfWeak = self;
+    [self scheduleForState:state afterDelay:BLERangingSchedulerActiveInterval block:^{
+        [selfWeak windowDidEnd:state];
+    }];
+}
+
+- (void) windowDidEnd:(BLERangingSchedulerRegion *)state
+{
+    if (state.changed) {
+        // keep ranging while proximity changes
+        [self startWindow:state];
+        return;
+    }
+
+    [self stopRanging:state];
+    self->_backoffsCount++;
+    NSTimeInterval idleInterval = state.idleInterval;
+    state.idleInterval = MIN(idleInterval * 2, BLERangingSchedulerMaxIdleInterval);
+    __weak typeof(self)selfWeak = self;
+    [self scheduleForState:state afterDelay:idleInterval block:^{
+        [selfWeak startWindow:state];
+    }];
+}
+
+- (void) stopRanging:(BLERangingSchedulerRegion *)state
+{
+    if (!state.ranging) {
+        return;
+    }
+    state.ranging = NO;
+    self->_rangingTimeInterval += BLEMonotonicTime() - state.rangingStartTime;
+    [self.delegate rangingScheduler:self stopRangingBeaconsInRegion:state.region];
+}
+
+/**
+ *  Schedule next step, previously scheduled step for region is cancelled
+ */
+- (void) scheduleForState:(BLERangingSchedulerRegion *)state afterDelay:(NSTimeInterval)delay block:(void(^)(void))block
+{
+    NSUInteger generation = ++state.generation;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        if (state.generation == generation) {
+            block();
+        }
+    });
+}
+
+@end
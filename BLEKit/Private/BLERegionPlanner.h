@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+#import <CoreLocation/CoreLocation.h>
+
+/**
+ *  Max number of regions monitored by application at a time
+ */
+#define BLERegionPlannerMaxRegions 20
+/**
+ *  Beacon seen within this interval is monitored before beacons close to last known location
+ */
+#define BLERegionPlannerSightingInterval (60 * 60)
+/**
+ *  Multiplexed beacon missing from this many ranging windows in a row is outside
+ */
+#define BLERegionPlannerLeaveWindows 3
+
+@class BLEBeacon;
+
+/**
+ *  Plans monitored regions within the system limit.
+ *
+ *  Regions of beacons sharing UUID+major, then UUID, are collapsed into wildcard regions
+ *  (multiplexed regions). If there are still too many regions, regions with recently seen beacons
+ *  and beacons close to last known location are monitored, and the set is rotated when
+ *  location changes. Enter to multiplexed region is resolved to beacons by ranging, beacon leaves
+ *  when region is left or when it's missing from ranging windows of region.
+ */
+@interface BLERegionPlanner : NSObject
+
+/**
+ *  Max number of regions in plan
+ */
+@property (assign) NSUInteger maxRegions;
+/**
+ *  Last known location, used to rank regions
+ */
+@property (strong) CLLocation *location;
+/**
+ *  Planned regions. @c CLBeaconRegion
+ */
+@property (strong, readonly) NSArray *regions;
+/**
+ *  YES if not all beacons fit in plan and regions should be planned again when location changes
+ */
+@property (assign, readonly, getter = isRotating) BOOL rotating;
+
+- (instancetype) initWithMaxRegions:(NSUInteger)maxRegions;
+
+/**
+ *  Plan regions for beacons
+ *
+ *  @param beacons Beacons. @c BLEBeacon
+ *
+ *  @return YES if planned regions changed
+ */
+- (BOOL) planRegionsForBeacons:(NSSet *)beacons;
+
+/**
+ *  Beacons covered by planned region
+ *
+ *  @param identifier Region identifier
+ *
+ *  @return Beacons or nil if region is not planned
+ */
+- (NSArray *) beaconsForRegionIdentifier:(NSString *)identifier;
+
+/**
+ *  Identifier of planned region covering beacon
+ *
+ *  @return Region identifier or nil if beacon is not monitored
+ */
+- (NSString *) regionIdentifierForBeacon:(BLEBeacon *)beacon;
+
+/**
+ *  YES if planned region covers beacons which events come from ranging
+ */
+- (BOOL) isMultiplexedRegionIdentifier:(NSString *)identifier;
+
+/**
+ *  YES if beacon is monitored with wildcard region of other beacons, and its events come from ranging
+ */
+- (BOOL) isMultiplexedBeacon:(BLEBeacon *)beacon;
+
+/**
+ *  Set state of multiplexed beacon
+ *
+ *  @return YES if state changed
+ */
+- (BOOL) setInside:(BOOL)inside forBeacon:(BLEBeacon *)beacon;
+
+/**
+ *  Record ranging window of region. Inside multiplexed beacons of region missing from window are counted,
+ *  beacon missing from BLERegionPlannerLeaveWindows windows in a row is set outside.
+ *
+ *  @param identifier    Region identifier
+ *  @param rangedBeacons Beacons ranged in window. @c BLEBeacon
+ *
+ *  @return Beacons set outside
+ */
+- (NSArray *) rangingWindowInRegionWithIdentifier:(NSString *)identifier rangedBeacons:(NSArray *)rangedBeacons;
+
+/**
+ *  Record that beacon was seen now
+ */
+- (void) beaconSighted:(BLEBeacon *)beacon;
+
+@end
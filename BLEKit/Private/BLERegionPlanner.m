@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLERegionPlanner.h"
+#import "BLEKit.h"
+#import "BLEKitPrivate.h"
+
+/**
+ *  Region candidate, beacons covered by key
+ */
+@interface BLERegionPlannerEntry : NSObject
+@property (assign) BLEBeaconKey key;
+@property (strong) NSMutableArray *beacons;
+@property (assign) NSTimeInterval lastSighting;
+@property (assign) CLLocationDistance distance;
+@end
+
+@implementation BLERegionPlannerEntry
+@end
+
+@implementation BLERegionPlanner {
+    NSDictionary *_beaconsByRegionIdentifier;
+    NSDictionary *_regionIdentifiersByIdentity;
+    NSSet *_multiplexedIdentities;
+    NSMutableSet *_insideIdentities;
+    /**
+     *  Ranging windows in a row inside multiplexed beacon was missing from
+     */
+    NSMutableDictionary *_missedWindows;
+    NSMutableDictionary *_sightings;
+}
+
+- (instancetype)init
+{
+    return [self initWithMaxRegions:BLERegionPlannerMaxRegions];
+}
+
+- (instancetype) initWithMaxRegions:(NSUInteger)maxRegions
+{
+    if (self = [super init]) {
+        self->_maxRegions = MAX(maxRegions, 1);
+        self->_regions = @[];
+        self->_beaconsByRegionIdentifier = @{};
+        self->_regionIdentifiersByIdentity = @{};
+        self->_multiplexedIdentities = [NSSet set];
+        self->_insideIdentities = [NSMutableSet set];
+        self->_missedWindows = [NSMutableDictionary dictionary];
+        self->_sightings = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+#pragma mark - Plan
+
+- (BOOL) planRegionsForBeacons:(NSSet *)beacons
+{
+    NSMutableDictionary *entries = [NSMutableDictionary dictionaryWithCapacity:beacons.count];
+    for (BLEBeacon *beacon in beacons) {
+        if (!beacon.proximityUUID || !beacon.zone.identifier) {
+            continue;
+        }
+
+        BLEBeaconIdentity *identity = [beacon beaconIdentity];
+        BLERegionPlannerEntry *entry = entries[identity];
+        if (!entry) {
+            entry = [[BLERegionPlannerEntry alloc] init];
+            entry.key = identity.key;
+            entry.beacons = [NSMutableArray array];
+            entries[identity] = entry;
+        }
+        [entry.beacons addObject:beacon];
+    }
+
+    @synchronized(self) {
+        NSUInteger maxRegions = self.maxRegions;
+        if (entries.count > maxRegions) {
+            [self collapseEntries:entries toFields:BLEBeaconKeyFieldMajor limit:maxRegions];
+        }
+        if (entries.count > maxRegions) {
+            [self collapseEntries:entries toFields:BLEBeaconKeyFieldNone limit:maxRegions];
+        }
+
+        NSArray *planned = [entries allValues];
+        self->_rotating = planned.count > maxRegions;
+        if (self.isRotating) {
+            planned = [[self rankEntries:planned] subarrayWithRange:NSMakeRange(0, maxRegions)];
+        }
+
+        NSMutableArray *regions = [NSMutableArray arrayWithCapacity:planned.count];
+        NSMutableDictionary *beaconsByRegionIdentifier = [NSMutableDictionary dictionaryWithCapacity:planned.count];
+        NSMutableDictionary *regionIdentifiersByIdentity = [NSMutableDictionary dictionaryWithCapacity:beacons.count];
+        NSMutableSet *multiplexedIdentities = [NSMutableSet set];
+        for (BLERegionPlannerEntry *entry in planned) {
+            CLBeaconRegion *region = [self regionForKey:entry.key];
+            [regions addObject:region];
+            beaconsByRegionIdentifier[region.identifier] = [entry.beacons copy];
+
+            BLEBeaconIdentity *regionIdentity = [BLEBeaconIdentity identityWithKey:entry.key];
+            for (BLEBeacon *beacon in entry.beacons) {
+                regionIdentifiersByIdentity[[beacon beaconIdentity]] = region.identifier;
+                if (![[beacon beaconIdentity] isEqualToIdentity:regionIdentity]) {
+                    [multiplexedIdentities addObject:[beacon beaconIdentity]];
+                }
+            }
+        }
+
+        BOOL changed = ![[NSSet setWithArray:[_regions valueForKey:@"identifier"]] isEqualToSet:[NSSet setWithArray:[regions valueForKey:@"identifier"]]];
+        self->_regions = [regions copy];
+        self->_beaconsByRegionIdentifier = [beaconsByRegionIdentifier copy];
+        self->_regionIdentifiersByIdentity = [regionIdentifiersByIdentity copy];
+        self->_multiplexedIdentities = [multiplexedIdentities copy];
+        [_insideIdentities intersectSet:_multiplexedIdentities];
+        for (BLEBeaconIdentity *identity in [_missedWindows allKeys]) {
+            if (![_insideIdentities containsObject:identity]) {
+                [_missedWindows removeObjectForKey:identity];
+            }
+        }
+
+#ifdef DEBUG
+        if (changed) {
+            NSLog(@"Planned %@ regions for %@ beacons, %@ multiplexed%@", @(regions.count), @(beacons.count), @(multiplexedIdentities.count), self.isRotating ? @", rotating" : @"");
+        }
+#endif
+        return changed;
+    }
+}
+
+/**
+ *  Merge entries reduced to the same key (UUID+major or UUID), largest groups first, until entries fit in limit
+ */
+- (void) collapseEntries:(NSMutableDictionary *)entries toFields:(BLEBeaconKeyFields)fields limit:(NSUInteger)limit
+{
+    NSMutableDictionary *groups = [NSMutableDictionary dictionary];
+    for (BLEBeaconIdentity *identity in entries) {
+        BLEBeaconIdentity *groupIdentity = [BLEBeaconIdentity identityWithKey:BLEBeaconKeyWithFields(identity.key, fields)];
+        NSMutableArray *group = groups[groupIdentity];
+        if (!group) {
+            group = [NSMutableArray array];
+            groups[groupIdentity] = group;
+        }
+        [group addObject:identity];
+    }
+
+    NSArray *groupIdentities = [groups keysSortedByValueUsingComparator:^NSComparisonResult(NSArray *group1, NSArray *group2) {
+        if (group1.count == group2.count) {
+            return NSOrderedSame;
+        }
+        return group1.count > group2.count ? NSOrderedAscending : NSOrderedDescending;
+    }];
+
+    for (BLEBeaconIdentity *groupIdentity in groupIdentities) {
+        NSArray *group = groups[groupIdentity];
+        if (entries.count <= limit || group.count < 2) {
+            break;
+        }
+
+        BLERegionPlannerEntry *merged = entries[groupIdentity];
+        if (!merged) {
+            merged = [[BLERegionPlannerEntry alloc] init];
+            merged.key = groupIdentity.key;
+            merged.beacons = [NSMutableArray array];
+        }
+        for (BLEBeaconIdentity *identity in group) {
+            if (![identity isEqualToIdentity:groupIdentity]) {
+                [merged.beacons addObjectsFromArray:[entries[identity] beacons]];
+                [entries removeObjectForKey:identity];
+            }
+        }
+        entries[groupIdentity] = merged;
+    }
+}
+
+/**
+ *  Recently seen first (most recent first), then nearest to last known location
+ */
+- (NSArray *) rankEntries:(NSArray *)entries
+{
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    CLLocation *location = self.location;
+    for (BLERegionPlannerEntry *entry in entries) {
+        entry.lastSighting = 0;
+        entry.distance = CLLocationDistanceMax;
+        for (BLEBeacon *beacon in entry.beacons) {
+            NSTimeInterval sighting = [_sightings[[beacon beaconIdentity]] doubleValue];
+            if (now - sighting < BLERegionPlannerSightingInterval) {
+                entry.lastSighting = MAX(entry.lastSighting, sighting);
+            }
+
+            BLELocation *beaconLocation = beacon.location ?: beacon.zone.location;
+            if (location && beaconLocation) {
+                CLLocation *coordinateLocation = [[CLLocation alloc] initWithLatitude:beaconLocation.coordinate.latitude longitude:beaconLocation.coordinate.longitude];
+                entry.distance = MIN(entry.distance, [location distanceFromLocation:coordinateLocation]);
+            }
+        }
+    }
+
+    return [entries sortedArrayUsingComparator:^NSComparisonResult(BLERegionPlannerEntry *entry1, BLERegionPlannerEntry *entry2) {
+        if (entry1.lastSighting != entry2.lastSighting) {
+            return entry1.lastSighting > entry2.lastSighting ? NSOrderedAscending : NSOrderedDescending;
+        }
+        if (entry1.distance != entry2.distance) {
+            return entry1.distance < entry2.distance ? NSOrderedAscending : NSOrderedDescending;
+        }
+        // stable order
+        return [BLEBeaconKeyString(entry1.key) compare:BLEBeaconKeyString(entry2.key)];
+    }];
+}
+
+- (CLBeaconRegion *) regionForKey:(BLEBeaconKey)key
+{
+    NSUUID *proximityUUID = [[NSUUID alloc] initWithUUIDBytes:key.proximityUUID];
+    NSString *identifier = BLEBeaconKeyString(key);
+
+    CLBeaconRegion *region = nil;
+    if ((key.fields & BLEBeaconKeyFieldMajor) && (key.fields & BLEBeaconKeyFieldMinor)) {
+        region = [[CLBeaconRegion alloc] initWithProximityUUID:proximityUUID major:key.major minor:key.minor identifier:identifier];
+    } else if (key.fields & BLEBeaconKeyFieldMajor) {
+        region = [[CLBeaconRegion alloc] initWithProximityUUID:proximityUUID major:key.major identifier:identifier];
+    } else {
+        region = [[CLBeaconRegion alloc] initWithProximityUUID:proximityUUID identifier:identifier];
+    }
+    region.notifyOnEntry = YES;
+    region.notifyOnExit = YES;
+    //FIXME: this perform didDetermineState every time phone go out of sleep
+    //When set to YES, the location manager sends beacon notifications when the user turns on the display and the device is already inside the region.
+    region.notifyEntryStateOnDisplay = YES;
+    return region;
+}
+
+#pragma mark - State
+
+- (NSArray *) beaconsForRegionIdentifier:(NSString *)identifier
+{
+    @synchronized(self) {
+        return _beaconsByRegionIdentifier[identifier];
+    }
+}
+
+- (NSString *) regionIdentifierForBeacon:(BLEBeacon *)beacon
+{
+    @synchronized(self) {
+        return _regionIdentifiersByIdentity[[beacon beaconIdentity]];
+    }
+}
+
+- (BOOL) isMultiplexedRegionIdentifier:(NSString *)identifier
+{
+    @synchronized(self) {
+        for (BLEBeacon *beacon in _beaconsByRegionIdentifier[identifier]) {
+            if ([_multiplexedIdentities containsObject:[beacon beaconIdentity]]) {
+                return YES;
+            }
+        }
+        return NO;
+    }
+}
+
+- (BOOL) isMultiplexedBeacon:(BLEBeacon *)beacon
+{
+    @synchronized(self) {
+        return [_multiplexedIdentities containsObject:[beacon beaconIdentity]];
+    }
+}
+
+- (BOOL) setInside:(BOOL)inside forBeacon:(BLEBeacon *)beacon
+{
+    BLEBeaconIdentity *identity = [beacon beaconIdentity];
+    @synchronized(self) {
+        [_missedWindows removeObjectForKey:identity];
+        if (inside == [_insideIdentities containsObject:identity]) {
+            return NO;
+        }
+        if (inside) {
+            [_insideIdentities addObject:identity];
+        } else {
+            [_insideIdentities removeObject:identity];
+        }
+        return YES;
+    }
+}
+
+- (NSArray *) rangingWindowInRegionWithIdentifier:(NSString *)identifier rangedBeacons:(NSArray *)rangedBeacons
+{
+    NSMutableSet *rangedIdentities = [NSMutableSet setWithCapacity:rangedBeacons.count];
+    for (BLEBeacon *beacon in rangedBeacons) {
+        [rangedIdentities addObject:[beacon beaconIdentity]];
+    }
+
+    NSMutableArray *leftBeacons = nil;
+    @synchronized(self) {
+        for (BLEBeacon *beacon in _beaconsByRegionIdentifier[identifier]) {
+            BLEBeaconIdentity *identity = [beacon beaconIdentity];
+            if (![_insideIdentities containsObject:identity]) {
+                continue;
+            }
+
+            if ([rangedIdentities containsObject:identity]) {
+                [_missedWindows removeObjectForKey:identity];
+                continue;
+            }
+
+            NSUInteger missed = [_missedWindows[identity] unsignedIntegerValue] + 1;
+            if (missed < BLERegionPlannerLeaveWindows) {
+                _missedWindows[identity] = @(missed);
+                continue;
+            }
+
+            [_missedWindows removeObjectForKey:identity];
+            [_insideIdentities removeObject:identity];
+            if (!leftBeacons) {
+                leftBeacons = [NSMutableArray array];
+            }
+            [leftBeacons addObject:beacon];
+        }
+    }
+    return leftBeacons;
+}
+
+- (void) beaconSighted:(BLEBeacon *)beacon
+{
+    @synchronized(self) {
+        _sightings[[beacon beaconIdentity]] = @([NSDate timeIntervalSinceReferenceDate]);
+    }
+}
+
+@end
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Version of state file layout. File with different version is recreated.
+ */
+#define BLEStateFileVersion 1
+
+/**
+ *  Type of state record
+ */
+typedef NS_ENUM(uint8_t, BLEStateRecordType) {
+    BLEStateRecordTypeFree = 0,
+    /**
+     *  Occurrence counter, integer value
+     */
+    BLEStateRecordTypeCounter = 1,
+    /**
+     *  Stays enter time, double value (reference date interval)
+     */
+    BLEStateRecordTypeStays = 2,
+    /**
+     *  Monitored region identifier, no value
+     */
+    BLEStateRecordTypeMonitoredRegion = 3
+};
+
+/**
+ *  Persistent runtime state of BLEKit.
+ *
+ *  Single memory-mapped file with header and fixed size records (type, key and 64-bit value).
+ *  Values are updated in place, record is appended before header count is updated
+ *  and record with invalid checksum is ignored, so interrupted update doesn't corrupt the file.
+ *  Changes are flushed to disk in background.
+ */
+@interface BLEStateFile : NSObject
+
+/**
+ *  Path to the file
+ */
+@property (strong, readonly) NSString *path;
+/**
+ *  YES if file was created, there was no state to restore
+ */
+@property (assign, readonly, getter = isCreated) BOOL created;
+
+/**
+ *  Shared state file. State from previous SAMCache based storage is migrated when file is created.
+ */
++ (instancetype) sharedStateFile;
+
+/**
+ *  Open or create state file
+ *
+ *  @param path Path to file
+ *
+ *  @return Initialized object
+ */
+- (instancetype) initWithPath:(NSString *)path;
+
+/**
+ *  Record for key and type
+ *
+ *  @param key    Key
+ *  @param type   Record type
+ *  @param create Create record with zero value if not found
+ *
+ *  @return Record index or NSNotFound
+ */
+- (NSUInteger) recordForKey:(NSString *)key type:(BLEStateRecordType)type create:(BOOL)create;
+
+/**
+ *  Remove record. Index may be reused for new record.
+ *
+ *  @param record Record index
+ */
+- (void) removeRecord:(NSUInteger)record;
+
+- (int64_t) integerValueAtRecord:(NSUInteger)record;
+- (void) setIntegerValue:(int64_t)value atRecord:(NSUInteger)record;
+- (double) doubleValueAtRecord:(NSUInteger)record;
+- (void) setDoubleValue:(double)value atRecord:(NSUInteger)record;
+
+/**
+ *  Keys of all records of type
+ *
+ *  @param type Record type
+ *
+ *  @return Set of keys
+ */
+- (NSSet *) keysForType:(BLEStateRecordType)type;
+
+/**
+ *  Replace records of type with given keys. Values of kept records are preserved.
+ *
+ *  @param keys Set of keys
+ *  @param type Record type
+ */
+- (void) setKeys:(NSSet *)keys forType:(BLEStateRecordType)type;
+
+/**
+ *  Remove records of type with keys not in given set, in single pass.
+ *
+ *  @param type Record type
+ *  @param keys Keys of records to keep
+ */
+- (void) removeRecordsOfType:(BLEStateRecordType)type exceptKeys:(NSSet *)keys;
+
+/**
+ *  Flush changes to disk. Blocks until written.
+ */
+- (void) synchronize;
+
+@end
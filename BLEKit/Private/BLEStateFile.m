@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+#import "BLEStateFile.h"
+#import "BLEStateFileMigrator.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BLEStateFileMagic 0x534B4C42 // BLKS
+#define BLEStateFileInitialCapacity 64
+#define BLEStateRecordKeyCapacity 112
+/**
+ *  Delay of flush, changes within are flushed together
+ */
+#define BLEStateFileFlushDelay 2.0
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    /**
+     *  Number of records in file
+     */
+    uint32_t capacity;
+    /**
+     *  Number of used records, records above are not initialized
+     */
+    uint32_t count;
+    uint32_t reserved[11];
+} BLEStateFileHeader;
+
+typedef struct {
+    /**
+     *  Checksum of type, key length and key
+     */
+    uint32_t checksum;
+    uint8_t type;
+    uint8_t keyLength;
+    uint16_t reserved;
+    /**
+     *  Integer or double bits
+     */
+    int64_t value;
+    char key[BLEStateRecordKeyCapacity];
+} BLEStateRecord;
+
+static inline uint32_t BLEStateRecordChecksum(const BLEStateRecord *record)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ record->type) * 16777619u;
+    hash = (hash ^ record->keyLength) * 16777619u;
+    for (uint8_t i = 0; i < record->keyLength && i < BLEStateRecordKeyCapacity; i++) {
+        hash = (hash ^ (uint8_t)record->key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static inline uint64_t BLEStateKeyHash(NSData *data, uint64_t seed)
+{
+    const uint8_t *bytes = data.bytes;
+    uint64_t hash = 14695981039346656037ull ^ seed;
+    for (NSUInteger i = 0; i < data.length; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ *  Key as stored in record. Keys longer than record capacity are replaced with 128-bit hash.
+ */
+static NSData *BLEStateStoredKey(NSString *key)
+{
+    NSData *data = [key dataUsingEncoding:NSUTF8StringEncoding];
+    if (data.length <= BLEStateRecordKeyCapacity) {
+        return data;
+    }
+    NSString *hashedKey = [NSString stringWithFormat:@"#%016llx%016llx", BLEStateKeyHash(data, 0), BLEStateKeyHash(data, 0x9e3779b97f4a7c15ull)];
+    return [hashedKey dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+@implementation BLEStateFile {
+    int _fd;
+    void *_map;
+    size_t _mapLength;
+    /**
+     *  Record index by stored key, for every type
+     */
+    NSMutableDictionary *_indexes;
+    NSMutableIndexSet *_freeRecords;
+    dispatch_queue_t _flushQueue;
+    BOOL _flushScheduled;
+}
+
++ (instancetype) sharedStateFile
+{
+    static BLEStateFile *sharedStateFile = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *cachesPath = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+        NSString *path = [[cachesPath stringByAppendingPathComponent:@"com.up-next.BLEKit"] stringByAppendingPathComponent:@"state.bin"];
+        sharedStateFile = [[BLEStateFile alloc] initWithPath:path];
+        if (sharedStateFile.isCreated) {
+            [BLEStateFileMigrator migrateSAMCacheToStateFile:sharedStateFile];
+        }
+    });
+    return sharedStateFile;
+}
+
+- (instancetype) initWithPath:(NSString *)path
+{
+    NSParameterAssert(path);
+
+    if (self = [super init]) {
+        self->_path = [path copy];
+        self->_fd = -1;
+        self->_indexes = [NSMutableDictionary dictionary];
+        self->_freeRecords = [NSMutableIndexSet indexSet];
+        self->_flushQueue = dispatch_queue_create("com.up-next.BLEKit.state", DISPATCH_QUEUE_SERIAL);
+
+        if (![self open]) {
+#ifdef DEBUG
+            NSLog(@"%@ Can't open state file %@. State is not persisted.", [self class], path);
+#endif
+            // keep state in memory only
+            [self mapAnonymousWithCapacity:BLEStateFileInitialCapacity];
+            self->_created = YES;
+        }
+
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationDidEnterBackground:) name:UIApplicationDidEnterBackgroundNotification object:nil];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationDidEnterBackground:) name:UIApplicationWillTerminateNotification object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    if (_map) {
+        if (_fd >= 0) {
+            msync(_map, _mapLength, MS_SYNC);
+        }
+        munmap(_map, _mapLength);
+    }
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+#pragma mark - Mapping
+
+- (BOOL) open
+{
+    [[NSFileManager defaultManager] createDirectoryAtPath:[_path stringByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nil];
+
+    _fd = open([_path fileSystemRepresentation], O_RDWR | O_CREAT, 0644);
+    if (_fd < 0) {
+        return NO;
+    }
+
+    struct stat st;
+    if (fstat(_fd, &st) != 0) {
+        return NO;
+    }
+
+    BOOL valid = NO;
+    if ((size_t)st.st_size >= sizeof(BLEStateFileHeader)) {
+        BLEStateFileHeader header;
+        if (pread(_fd, &header, sizeof(header), 0) == sizeof(header)) {
+            valid = header.magic == BLEStateFileMagic &&
+                    header.version == BLEStateFileVersion &&
+                    header.recordSize == sizeof(BLEStateRecord) &&
+                    header.count <= header.capacity &&
+                    (size_t)st.st_size >= sizeof(BLEStateFileHeader) + (size_t)header.capacity * sizeof(BLEStateRecord);
+        }
+    }
+
+    if (!valid) {
+        // new file or unsupported version, start over
+        _created = YES;
+        if (ftruncate(_fd, 0) != 0 || ![self mapFileWithCapacity:BLEStateFileInitialCapacity]) {
+            return NO;
+        }
+        BLEStateFileHeader *header = _map;
+        header->magic = BLEStateFileMagic;
+        header->version = BLEStateFileVersion;
+        header->recordSize = sizeof(BLEStateRecord);
+        header->capacity = BLEStateFileInitialCapacity;
+        header->count = 0;
+        msync(_map, _mapLength, MS_SYNC);
+        return YES;
+    }
+
+    BLEStateFileHeader header;
+    pread(_fd, &header, sizeof(header), 0);
+    if (![self mapFileWithCapacity:header.capacity]) {
+        return NO;
+    }
+    [self loadRecords];
+    return YES;
+}
+
+- (BOOL) mapFileWithCapacity:(uint32_t)capacity
+{
+    size_t length = sizeof(BLEStateFileHeader) + (size_t)capacity * sizeof(BLEStateRecord);
+    struct stat st;
+    if (fstat(_fd, &st) != 0) {
+        return NO;
+    }
+    if ((size_t)st.st_size < length && ftruncate(_fd, (off_t)length) != 0) {
+        return NO;
+    }
+
+    void *map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (map == MAP_FAILED) {
+        return NO;
+    }
+
+    if (_map) {
+        munmap(_map, _mapLength);
+    }
+    _map = map;
+    _mapLength = length;
+    return YES;
+}
+
+- (void) mapAnonymousWithCapacity:(uint32_t)capacity
+{
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+
+    size_t length = sizeof(BLEStateFileHeader) + (size_t)capacity * sizeof(BLEStateRecord);
+    void *map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    NSAssert(map != MAP_FAILED, @"Can't allocate state");
+
+    BLEStateFileHeader *header = map;
+    if (_map) {
+        memcpy(map, _map, MIN(length, _mapLength));
+        munmap(_map, _mapLength);
+    } else {
+        header->magic = BLEStateFileMagic;
+        header->version = BLEStateFileVersion;
+        header->recordSize = sizeof(BLEStateRecord);
+        header->count = 0;
+    }
+    header->capacity = capacity;
+    _map = map;
+    _mapLength = length;
+}
+
+- (BLEStateFileHeader *) header
+{
+    return _map;
+}
+
+- (BLEStateRecord *) records
+{
+    return (BLEStateRecord *)((uint8_t *)_map + sizeof(BLEStateFileHeader));
+}
+
+- (NSMutableDictionary *) indexForType:(BLEStateRecordType)type
+{
+    NSMutableDictionary *index = _indexes[@(type)];
+    if (!index) {
+        index = [NSMutableDictionary dictionary];
+        _indexes[@(type)] = index;
+    }
+    return index;
+}
+
+/**
+ *  Build indexes from mapped records
+ */
+- (void) loadRecords
+{
+    BLEStateFileHeader *header = [self header];
+    BLEStateRecord *records = [self records];
+    for (uint32_t i = 0; i < header->count; i++) {
+        BLEStateRecord *record = &records[i];
+        if (record->type == BLEStateRecordTypeFree || record->keyLength > BLEStateRecordKeyCapacity || record->checksum != BLEStateRecordChecksum(record)) {
+            record->type = BLEStateRecordTypeFree;
+            [_freeRecords addIndex:i];
+            continue;
+        }
+
+        NSData *key = [NSData dataWithBytes:record->key length:record->keyLength];
+        NSMutableDictionary *index = [self indexForType:record->type];
+        if (index[key]) {
+            // duplicate, keep the first one
+            record->type = BLEStateRecordTypeFree;
+            [_freeRecords addIndex:i];
+            continue;
+        }
+        index[key] = @(i);
+    }
+}
+
+#pragma mark - Records
+
+- (NSUInteger) recordForKey:(NSString *)key type:(BLEStateRecordType)type create:(BOOL)create
+{
+    NSParameterAssert(key);
+    NSParameterAssert(type != BLEStateRecordTypeFree);
+
+    NSData *storedKey = BLEStateStoredKey(key);
+    @synchronized(self) {
+        NSMutableDictionary *index = [self indexForType:type];
+        NSNumber *recordNumber = index[storedKey];
+        if (recordNumber) {
+            return [recordNumber unsignedIntegerValue];
+        }
+        if (!create) {
+            return NSNotFound;
+        }
+
+        NSUInteger recordIndex = [self allocateRecord];
+        BLEStateRecord *record = &[self records][recordIndex];
+        record->value = 0;
+        record->type = type;
+        record->keyLength = (uint8_t)storedKey.length;
+        record->reserved = 0;
+        memset(record->key, 0, BLEStateRecordKeyCapacity);
+        memcpy(record->key, storedKey.bytes, storedKey.length);
+        record->checksum = BLEStateRecordChecksum(record);
+
+        // publish record after it's written
+        BLEStateFileHeader *header = [self header];
+        if (recordIndex >= header->count) {
+            header->count = (uint32_t)recordIndex + 1;
+        }
+
+        index[storedKey] = @(recordIndex);
+        [self setNeedsFlush];
+        return recordIndex;
+    }
+}
+
+/**
+ *  Free record or new one at the end. Called with lock held.
+ */
+- (NSUInteger) allocateRecord
+{
+    NSUInteger recordIndex = [_freeRecords firstIndex];
+    if (recordIndex != NSNotFound) {
+        [_freeRecords removeIndex:recordIndex];
+        return recordIndex;
+    }
+
+    BLEStateFileHeader *header = [self header];
+    if (header->count == header->capacity) {
+        uint32_t capacity = header->capacity * 2;
+        if (_fd >= 0 && [self mapFileWithCapacity:capacity]) {
+            [self header]->capacity = capacity;
+        } else {
+            [self mapAnonymousWithCapacity:capacity];
+        }
+    }
+    return [self header]->count;
+}
+
+- (void) removeRecord:(NSUInteger)recordIndex
+{
+    @synchronized(self) {
+        NSParameterAssert(recordIndex < [self header]->count);
+
+        BLEStateRecord *record = &[self records][recordIndex];
+        if (record->type == BLEStateRecordTypeFree) {
+            return;
+        }
+        NSData *key = [NSData dataWithBytes:record->key length:record->keyLength];
+        [[self indexForType:record->type] removeObjectForKey:key];
+
+        record->type = BLEStateRecordTypeFree;
+        record->checksum = BLEStateRecordChecksum(record);
+        [_freeRecords addIndex:recordIndex];
+        [self setNeedsFlush];
+    }
+}
+
+- (int64_t) integerValueAtRecord:(NSUInteger)recordIndex
+{
+    @synchronized(self) {
+        NSParameterAssert(recordIndex < [self header]->count);
+        return [self records][recordIndex].value;
+    }
+}
+
+- (void) setIntegerValue:(int64_t)value atRecord:(NSUInteger)recordIndex
+{
+    @synchronized(self) {
+        NSParameterAssert(recordIndex < [self header]->count);
+        BLEStateRecord *record = &[self records][recordIndex];
+        if (record->value != value) {
+            record->value = value;
+            [self setNeedsFlush];
+        }
+    }
+}
+
+- (double) doubleValueAtRecord:(NSUInteger)recordIndex
+{
+    int64_t bits = [self integerValueAtRecord:recordIndex];
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+- (void) setDoubleValue:(double)value atRecord:(NSUInteger)recordIndex
+{
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    [self setIntegerValue:bits atRecord:recordIndex];
+}
+
+- (NSSet *) keysForType:(BLEStateRecordType)type
+{
+    @synchronized(self) {
+        NSMutableSet *keys = [NSMutableSet set];
+        for (NSData *key in [self indexForType:type]) {
+            NSString *string = [[NSString alloc] initWithData:key encoding:NSUTF8StringEncoding];
+            if (string) {
+                [keys addObject:string];
+            }
+        }
+        return [keys copy];
+    }
+}
+
+- (void) setKeys:(NSSet *)keys forType:(BLEStateRecordType)type
+{
+    @synchronized(self) {
+        for (NSString *key in keys) {
+            [self recordForKey:key type:type create:YES];
+        }
+        [self removeRecordsOfType:type exceptKeys:keys];
+    }
+}
+
+- (void) removeRecordsOfType:(BLEStateRecordType)type exceptKeys:(NSSet *)keys
+{
+    NSMutableSet *storedKeys = [NSMutableSet setWithCapacity:keys.count];
+    for (NSString *key in keys) {
+        [storedKeys addObject:BLEStateStoredKey(key)];
+    }
+
+    @synchronized(self) {
+        NSDictionary *index = [[self indexForType:type] copy];
+        for (NSData *storedKey in index) {
+            if (![storedKeys containsObject:storedKey]) {
+                [self removeRecord:[index[storedKey] unsignedIntegerValue]];
+            }
+        }
+    }
+}
+
+#pragma mark - Flush
+
+- (void) setNeedsFlush
+{
+    if (_flushScheduled || _fd < 0) {
+        return;
+    }
+    _flushScheduled = YES;
+
+    __weak typeof(self)selfWeak = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(BLEStateFileFlushDelay * NSEC_PER_SEC)), _flushQueue, ^{
+        [selfWeak flush:MS_ASYNC];
+    });
+}
+
+- (void) flush:(int)flags
+{
+    @synchronized(self) {
+        _flushScheduled = NO;
+        if (_map && _fd >= 0) {
+            msync(_map, _mapLength, flags);
+        }
+    }
+}
+
+- (void) synchronize
+{
+    dispatch_sync(_flushQueue, ^{
+        [self flush:MS_SYNC];
+    });
+}
+
+#pragma mark - Notifications
+
+- (void) applicationDidEnterBackground:(NSNotification *)notification
+{
+    [self synchronize];
+}
+
+@end
@@ -26,18 +26,22 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#import "SAMCache.h"
-#import "BLEKit.h"
 
-#define BLECacheActionIdentifierFormat(action,beacon) \
-    [NSString stringWithFormat:@"beacon.%@.action.%@.type.%@", beacon.identifier, action.uniqueIdentifier, action.type]
+#import <Foundation/Foundation.h>
 
-@interface SAMCache (BLEKit)
+@class BLEStateFile;
 
-+ (SAMCache *) actionCache;
-+ (SAMCache *) monitoredProximityCache;
+/**
+ *  Migrates state stored by previous versions with SAMCache (one archived file per key) to state file.
+ */
+@interface BLEStateFileMigrator : NSObject
 
-- (void)incrementUsageNumberValueForAction:(id <BLEAction>)action;
-- (void)setObject:(id<NSCopying>)object forAction:(id <BLEAction>)action;
+/**
+ *  Copy occurrence counters, stays enter times and monitored regions to state file
+ *  and remove old cache directories.
+ *
+ *  @param stateFile Destination state file
+ */
++ (void) migrateSAMCacheToStateFile:(BLEStateFile *)stateFile;
 
 @end
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEStateFileMigrator.h"
+#import "BLEStateFile.h"
+
+static NSString * const BLEStateFileMigratorActionCacheName = @"com.up-next.BLEKit.action";
+static NSString * const BLEStateFileMigratorMonitoredCacheName = @"com.up-next.BLEKit.monitored";
+static NSString * const BLEStateFileMigratorMonitoredKey = @"monitoredRegionIdentifiers";
+static NSString * const BLEStateFileMigratorStaysCachePrefix = @"com.up-next.BLEKit.stays.";
+
+@implementation BLEStateFileMigrator
+
++ (void) migrateSAMCacheToStateFile:(BLEStateFile *)stateFile
+{
+    NSParameterAssert(stateFile);
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *cachesDirectory = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) lastObject];
+    NSString *samCacheDirectory = [cachesDirectory stringByAppendingPathComponent:@"com.samsoffes.samcache"];
+
+    NSArray *cacheNames = [fileManager contentsOfDirectoryAtPath:samCacheDirectory error:nil];
+    for (NSString *cacheName in cacheNames) {
+        NSString *cacheDirectory = [samCacheDirectory stringByAppendingPathComponent:cacheName];
+
+        if ([cacheName isEqualToString:BLEStateFileMigratorActionCacheName]) {
+            // key is file name, counter keys have no characters sanitized by SAMCache
+            for (NSString *key in [fileManager contentsOfDirectoryAtPath:cacheDirectory error:nil]) {
+                NSNumber *value = [self objectOfClass:[NSNumber class] atPath:[cacheDirectory stringByAppendingPathComponent:key]];
+                if (value) {
+                    NSUInteger record = [stateFile recordForKey:key type:BLEStateRecordTypeCounter create:YES];
+                    [stateFile setIntegerValue:[value longLongValue] atRecord:record];
+                }
+            }
+        } else if ([cacheName isEqualToString:BLEStateFileMigratorMonitoredCacheName]) {
+            NSSet *identifiers = [self objectOfClass:[NSSet class] atPath:[cacheDirectory stringByAppendingPathComponent:BLEStateFileMigratorMonitoredKey]];
+            if (identifiers) {
+                [stateFile setKeys:identifiers forType:BLEStateRecordTypeMonitoredRegion];
+            }
+        } else if ([cacheName hasPrefix:BLEStateFileMigratorStaysCachePrefix]) {
+            // one cache per beacon
+            for (NSString *key in [fileManager contentsOfDirectoryAtPath:cacheDirectory error:nil]) {
+                NSDate *enterDate = [self objectOfClass:[NSDate class] atPath:[cacheDirectory stringByAppendingPathComponent:key]];
+                if (enterDate) {
+                    NSUInteger record = [stateFile recordForKey:key type:BLEStateRecordTypeStays create:YES];
+                    [stateFile setDoubleValue:[enterDate timeIntervalSinceReferenceDate] atRecord:record];
+                }
+            }
+        } else {
+            continue;
+        }
+
+        [fileManager removeItemAtPath:cacheDirectory error:nil];
+    }
+
+    [stateFile synchronize];
+}
+
++ (id) objectOfClass:(Class)class atPath:(NSString *)path
+{
+    id object = nil;
+    @try {
+        object = [NSKeyedUnarchiver unarchiveObjectWithFile:path];
+    }
+    @catch (NSException *exception) {
+#ifdef DEBUG
+        NSLog(@"%@ Can't migrate %@. %@", self, path, exception.reason);
+#endif
+    }
+    return [object isKindOfClass:class] ? object : nil;
+}
+
+@end
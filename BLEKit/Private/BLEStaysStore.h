@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+@class BLEStateFile;
+
+/**
+ *  Enter times of beacons for stays conditions.
+ *
+ *  Enter times are stays records of state file.
+ *  @see BLEStateFile
+ */
+@interface BLEStaysStore : NSObject
+
+/**
+ *  Shared store
+ */
++ (instancetype) sharedStore;
+
+/**
+ *  Initialize store with enter times from state file
+ *
+ *  @param stateFile State file
+ *
+ *  @return Initialized object
+ */
+- (instancetype) initWithStateFile:(BLEStateFile *)stateFile;
+
+/**
+ *  Record enter for beacon now
+ *
+ *  @param identifier beacon identifier
+ */
+- (void) enterBeaconWithIdentifier:(NSString *)identifier;
+
+/**
+ *  Record enter for beacon now, only if there is no enter recorded
+ *
+ *  @param identifier beacon identifier
+ */
+- (void) enterBeaconIfNeededWithIdentifier:(NSString *)identifier;
+
+/**
+ *  Remove enter record for beacon
+ *
+ *  @param identifier beacon identifier
+ */
+- (void) leaveBeaconWithIdentifier:(NSString *)identifier;
+
+/**
+ *  Expire enter records of beacons not in given set. Called after zone is loaded. Empty set is ignored.
+ *
+ *  @param identifiers identifiers of current beacons
+ */
+- (void) reconcileWithBeaconIdentifiers:(NSSet *)identifiers;
+
+/**
+ *  Check if enter is recorded for beacon
+ *
+ *  @param identifier beacon identifier
+ *
+ *  @return YES if beacon is entered
+ */
+- (BOOL) isEnteredBeaconWithIdentifier:(NSString *)identifier;
+
+/**
+ *  Time since enter.
+ *
+ *  @param identifier beacon identifier
+ *
+ *  @return Time interval or 0 if beacon is not entered.
+ */
+- (NSTimeInterval) staysTimeIntervalForIdentifier:(NSString *)identifier;
+
+/**
+ *  Write pending changes now. Blocks until written.
+ */
+- (void) synchronize;
+
+@end
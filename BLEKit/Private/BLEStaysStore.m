@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEStaysStore.h"
+#import "BLEStateFile.h"
+
+@implementation BLEStaysStore {
+    BLEStateFile *_stateFile;
+}
+
++ (instancetype) sharedStore
+{
+    static BLEStaysStore *sharedStore = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedStore = [[BLEStaysStore alloc] initWithStateFile:[BLEStateFile sharedStateFile]];
+    });
+    return sharedStore;
+}
+
+- (instancetype) initWithStateFile:(BLEStateFile *)stateFile
+{
+    NSParameterAssert(stateFile);
+
+    if (self = [super init]) {
+        self->_stateFile = stateFile;
+    }
+    return self;
+}
+
+#pragma mark - Public
+
+- (void) enterBeaconWithIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+
+    NSUInteger record = [_stateFile recordForKey:identifier type:BLEStateRecordTypeStays create:YES];
+    [_stateFile setDoubleValue:[NSDate timeIntervalSinceReferenceDate] atRecord:record];
+}
+
+- (void) enterBeaconIfNeededWithIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+
+    @synchronized(_stateFile) {
+        if ([_stateFile recordForKey:identifier type:BLEStateRecordTypeStays create:NO] == NSNotFound) {
+            [self enterBeaconWithIdentifier:identifier];
+        }
+    }
+}
+
+- (void) leaveBeaconWithIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+
+    @synchronized(_stateFile) {
+        NSUInteger record = [_stateFile recordForKey:identifier type:BLEStateRecordTypeStays create:NO];
+        if (record != NSNotFound) {
+            [_stateFile removeRecord:record];
+        }
+    }
+}
+
+- (void) reconcileWithBeaconIdentifiers:(NSSet *)identifiers
+{
+    // empty set is not a loaded zone
+    if (identifiers.count == 0) {
+        return;
+    }
+    [_stateFile removeRecordsOfType:BLEStateRecordTypeStays exceptKeys:identifiers];
+}
+
+- (BOOL) isEnteredBeaconWithIdentifier:(NSString *)identifier
+{
+    if (!identifier) {
+        return NO;
+    }
+
+    @synchronized(_stateFile) {
+        return [_stateFile recordForKey:identifier type:BLEStateRecordTypeStays create:NO] != NSNotFound;
+    }
+}
+
+- (NSTimeInterval) staysTimeIntervalForIdentifier:(NSString *)identifier
+{
+    if (!identifier) {
+        return 0;
+    }
+
+    @synchronized(_stateFile) {
+        NSUInteger record = [_stateFile recordForKey:identifier type:BLEStateRecordTypeStays create:NO];
+        if (record != NSNotFound) {
+            return [NSDate timeIntervalSinceReferenceDate] - [_stateFile doubleValueAtRecord:record];
+        }
+    }
+    return 0;
+}
+
+- (void) synchronize
+{
+    [_stateFile synchronize];
+}
+
+@end
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+@class BLEStaysTimerWheel, BLEBeacon;
+
+@protocol BLEStaysTimerWheelDelegate <NSObject>
+/**
+ *  Time based event for beacon
+ *
+ *  @param wheel  Timer wheel
+ *  @param beacon Beacon
+ */
+- (void) staysTimerWheel:(BLEStaysTimerWheel *)wheel didFireForBeacon:(BLEBeacon *)beacon;
+@end
+
+/**
+ *  Periodic time based events for beacons, driven by single timer.
+ *
+ *  Deadlines are rounded up to resolution and kept in wheel slots, so beacons due in the same slot
+ *  are fired with one wakeup and timer is armed only for the nearest non empty slot.
+ *  Events are not fired while application is in background.
+ *
+ *  Use from main queue only.
+ */
+@interface BLEStaysTimerWheel : NSObject
+
+/**
+ *  Period of events for every beacon
+ */
+@property (assign, readonly) NSTimeInterval interval;
+/**
+ *  Delegate
+ */
+@property (weak) id <BLEStaysTimerWheelDelegate> delegate;
+
+/**
+ *  Initialize wheel
+ *
+ *  @param interval   Period of events
+ *  @param resolution Resolution of the wheel, events are coalesced within
+ *
+ *  @return Initialized object
+ */
+- (instancetype) initWithInterval:(NSTimeInterval)interval resolution:(NSTimeInterval)resolution;
+
+/**
+ *  Start periodic events for beacon. Nothing happens if beacon is already added.
+ */
+- (void) addBeacon:(BLEBeacon *)beacon;
+/**
+ *  Stop periodic events for beacon
+ */
+- (void) removeBeacon:(BLEBeacon *)beacon;
+/**
+ *  Stop all events
+ */
+- (void) removeAllBeacons;
+
+@end
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+#import "BLEStaysTimerWheel.h"
+#import "BLEMonotonicClock.h"
+
+@implementation BLEStaysTimerWheel {
+    dispatch_source_t _timer;
+    NSTimeInterval _resolution;
+    NSTimeInterval _startTime;
+    uint64_t _intervalTicks;
+    /**
+     *  Last processed tick, all deadlines are in (_processedTick, _processedTick + _intervalTicks]
+     */
+    uint64_t _processedTick;
+    /**
+     *  Slots with beacons, deadline tick % slots count
+     */
+    NSArray *_slots;
+    /**
+     *  Deadline tick for beacon
+     */
+    NSMapTable *_deadlines;
+    BOOL _suspended;
+}
+
+- (instancetype) initWithInterval:(NSTimeInterval)interval resolution:(NSTimeInterval)resolution
+{
+    NSParameterAssert(interval > 0);
+    NSParameterAssert(resolution > 0 && resolution <= interval);
+
+    if (self = [super init]) {
+        self->_interval = interval;
+        self->_resolution = resolution;
+        self->_intervalTicks = MAX(1, (uint64_t)ceil(interval / resolution));
+        self->_startTime = BLEMonotonicTime();
+
+        NSMutableArray *slots = [NSMutableArray arrayWithCapacity:(NSUInteger)_intervalTicks + 1];
+        for (uint64_t i = 0; i <= _intervalTicks; i++) {
+            [slots addObject:[NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality]];
+        }
+        self->_slots = [slots copy];
+        self->_deadlines = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+
+        self->_suspended = [[UIApplication sharedApplication] applicationState] == UIApplicationStateBackground;
+
+        __weak typeof(self)selfWeak = self;
+        self->_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+        dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        dispatch_source_set_event_handler(_timer, ^{
+            [selfWeak handleTimer];
+        });
+        dispatch_resume(_timer);
+
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationDidEnterBackground:) name:UIApplicationDidEnterBackgroundNotification object:nil];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationDidBecomeActive:) name:UIApplicationDidBecomeActiveNotification object:nil];
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    return [self initWithInterval:60 resolution:5];
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    if (_timer) {
+        dispatch_source_cancel(_timer);
+    }
+}
+
+#pragma mark - Public
+
+- (void) addBeacon:(BLEBeacon *)beacon
+{
+    NSParameterAssert(beacon);
+
+    if ([_deadlines objectForKey:beacon]) {
+        return;
+    }
+
+    NSArray *firedBeacons = [self advance];
+    if (firedBeacons.count > 0 && !_suspended) {
+        __weak typeof(self)selfWeak = self;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [selfWeak notifyBeacons:firedBeacons];
+        });
+    }
+
+    [self scheduleBeacon:beacon atTick:_processedTick + _intervalTicks];
+    [self arm];
+}
+
+- (void) removeBeacon:(BLEBeacon *)beacon
+{
+    NSNumber *deadline = [_deadlines objectForKey:beacon];
+    if (deadline) {
+        [_slots[[self slotIndexForTick:[deadline unsignedLongLongValue]]] removeObject:beacon];
+        [_deadlines removeObjectForKey:beacon];
+        if (_deadlines.count == 0) {
+            [self arm];
+        }
+    }
+}
+
+- (void) removeAllBeacons
+{
+    for (NSHashTable *slot in _slots) {
+        [slot removeAllObjects];
+    }
+    [_deadlines removeAllObjects];
+    [self arm];
+}
+
+#pragma mark - Wheel
+
+- (uint64_t) currentTick
+{
+    NSTimeInterval elapsed = BLEMonotonicTime() - _startTime;
+    // small tolerance for timer firing right at the slot time
+    return (uint64_t)floor(elapsed / _resolution + 0.001);
+}
+
+- (NSUInteger) slotIndexForTick:(uint64_t)tick
+{
+    return (NSUInteger)(tick % _slots.count);
+}
+
+- (void) scheduleBeacon:(BLEBeacon *)beacon atTick:(uint64_t)tick
+{
+    [_deadlines setObject:@(tick) forKey:beacon];
+    [_slots[[self slotIndexForTick:tick]] addObject:beacon];
+}
+
+/**
+ *  Move wheel to current tick, reschedule due beacons.
+ *
+ *  @return Due beacons
+ */
+- (NSArray *) advance
+{
+    uint64_t nowTick = [self currentTick];
+    if (nowTick <= _processedTick) {
+        return nil;
+    }
+
+    NSMutableArray *firedBeacons = nil;
+    if (_deadlines.count > 0) {
+        // visit every slot at most once
+        uint64_t fromTick = MAX(_processedTick + 1, nowTick >= _slots.count ? nowTick - _slots.count + 1 : 0);
+        for (uint64_t tick = fromTick; tick <= nowTick; tick++) {
+            NSHashTable *slot = _slots[[self slotIndexForTick:tick]];
+            if (slot.count == 0) {
+                continue;
+            }
+
+            for (BLEBeacon *beacon in [slot allObjects]) {
+                if ([[_deadlines objectForKey:beacon] unsignedLongLongValue] <= nowTick) {
+                    [slot removeObject:beacon];
+                    if (!firedBeacons) {
+                        firedBeacons = [NSMutableArray array];
+                    }
+                    [firedBeacons addObject:beacon];
+                }
+            }
+        }
+    }
+
+    _processedTick = nowTick;
+    for (BLEBeacon *beacon in firedBeacons) {
+        [self scheduleBeacon:beacon atTick:nowTick + _intervalTicks];
+    }
+    return firedBeacons;
+}
+
+/**
+ *  Arm timer for the nearest non empty slot
+ */
+- (void) arm
+{
+    if (_suspended || _deadlines.count == 0) {
+        dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        return;
+    }
+
+    for (uint64_t tick = _processedTick + 1; tick <= _processedTick + _intervalTicks; tick++) {
+        if ([_slots[[self slotIndexForTick:tick]] count] > 0) {
+            NSTimeInterval delay = MAX(0, _startTime + tick * _resolution - BLEMonotonicTime());
+            dispatch_source_set_timer(_timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, 1 * NSEC_PER_SEC);
+            return;
+        }
+    }
+}
+
+- (void) handleTimer
+{
+    NSArray *firedBeacons = [self advance];
+    [self arm];
+    if (!_suspended) {
+        [self notifyBeacons:firedBeacons];
+    }
+}
+
+- (void) notifyBeacons:(NSArray *)beacons
+{
+    __strong __typeof(self.delegate)delegateStrong = self.delegate;
+    for (BLEBeacon *beacon in beacons) {
+        // may be removed meanwhile
+        if ([_deadlines objectForKey:beacon]) {
+#ifdef DEBUG
+            NSLog(@"%@ Time based event for beacon %@.", [self class], beacon);
+#endif
+            [delegateStrong staysTimerWheel:self didFireForBeacon:beacon];
+        }
+    }
+}
+
+#pragma mark - Notifications
+
+- (void) applicationDidEnterBackground:(NSNotification *)notification
+{
+    _suspended = YES;
+    [self arm];
+}
+
+- (void) applicationDidBecomeActive:(NSNotification *)notification
+{
+    if (_suspended) {
+        _suspended = NO;
+        // skip events due while in background
+        [self advance];
+        [self arm];
+    }
+}
+
+@end
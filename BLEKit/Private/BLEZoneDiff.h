@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+@class BLEZone;
+
+/**
+ *  Structural difference between loaded beacons and replacement zone.
+ *
+ *  Beacons are matched by identity, triggers by unique identifier. Matched beacons
+ *  and unchanged triggers and conditions keep their instances, so runtime state
+ *  (proximity, stays, scheduled events, compiled conditions) survives reload.
+ */
+@interface BLEZoneDiff : NSObject
+
+/**
+ *  Beacons after reload: kept instances and added beacons
+ */
+@property (strong, readonly) NSSet *beacons;
+/**
+ *  Beacons of the replacement zone not loaded before
+ */
+@property (strong, readonly) NSSet *addedBeacons;
+/**
+ *  Loaded beacons missing in the replacement zone
+ */
+@property (strong, readonly) NSSet *removedBeacons;
+/**
+ *  Loaded beacons which definition (properties, triggers, conditions) changed
+ */
+@property (strong, readonly) NSSet *updatedBeacons;
+
+/**
+ *  Compute difference
+ *
+ *  @param beacons Loaded beacons
+ *  @param zone    Replacement zone
+ *
+ *  @return Initialized object
+ */
+- (instancetype) initWithBeacons:(NSSet *)beacons zone:(BLEZone *)zone;
+
+/**
+ *  YES if anything changed
+ */
+- (BOOL) hasChanges;
+
+/**
+ *  Copy changed definitions to the kept beacons and attach them to replacement zone
+ */
+- (void) apply;
+
+@end
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEZoneDiff.h"
+#import "BLEKit.h"
+#import "BLEKitPrivate.h"
+
+static inline BOOL BLEZoneDiffEqualObjects(id obj1, id obj2)
+{
+    return obj1 == obj2 || [obj1 isEqual:obj2];
+}
+
+@implementation BLEZoneDiff {
+    BLEZone *_zone;
+    /**
+     *  Replacement beacon by kept beacon, for every matched beacon
+     */
+    NSMapTable *_replacements;
+}
+
+- (instancetype) initWithBeacons:(NSSet *)beacons zone:(BLEZone *)zone
+{
+    NSParameterAssert(zone);
+
+    if (self = [super init]) {
+        self->_zone = zone;
+        self->_replacements = [NSMapTable strongToStrongObjectsMapTable];
+        [self computeWithBeacons:beacons];
+    }
+    return self;
+}
+
+- (void) computeWithBeacons:(NSSet *)loadedBeacons
+{
+    NSMutableDictionary *loadedByIdentity = [NSMutableDictionary dictionaryWithCapacity:loadedBeacons.count];
+    for (BLEBeacon *beacon in loadedBeacons) {
+        loadedByIdentity[[beacon beaconIdentity]] = beacon;
+    }
+
+    NSMutableSet *beacons = [NSMutableSet setWithCapacity:_zone.beacons.count];
+    NSMutableSet *addedBeacons = [NSMutableSet set];
+    NSMutableSet *updatedBeacons = [NSMutableSet set];
+    for (BLEBeacon *beacon in _zone.beacons) {
+        BLEBeaconIdentity *identity = [beacon beaconIdentity];
+        BLEBeacon *loadedBeacon = loadedByIdentity[identity];
+        if (!loadedBeacon) {
+            [addedBeacons addObject:beacon];
+            [beacons addObject:beacon];
+            continue;
+        }
+
+        [loadedByIdentity removeObjectForKey:identity];
+        [beacons addObject:loadedBeacon];
+        [_replacements setObject:beacon forKey:loadedBeacon];
+        if (![self isBeacon:loadedBeacon equalToBeacon:beacon]) {
+            [updatedBeacons addObject:loadedBeacon];
+        }
+    }
+
+    self->_beacons = [beacons copy];
+    self->_addedBeacons = [addedBeacons copy];
+    self->_removedBeacons = [NSSet setWithArray:[loadedByIdentity allValues]];
+    self->_updatedBeacons = [updatedBeacons copy];
+}
+
+- (BOOL) hasChanges
+{
+    return self.addedBeacons.count > 0 || self.removedBeacons.count > 0 || self.updatedBeacons.count > 0;
+}
+
+#pragma mark - Comparison
+
+- (BOOL) isBeacon:(BLEBeacon *)beacon1 equalToBeacon:(BLEBeacon *)beacon2
+{
+    if (!BLEZoneDiffEqualObjects(beacon1.name, beacon2.name) ||
+        !BLEZoneDiffEqualObjects(beacon1.desc, beacon2.desc) ||
+        !BLEZoneDiffEqualObjects(beacon1.parameters, beacon2.parameters) ||
+        !BLEZoneDiffEqualObjects(beacon1.zone.identifier, beacon2.zone.identifier)) {
+        return NO;
+    }
+
+    if ((beacon1.location == nil) != (beacon2.location == nil) ||
+        beacon1.location.coordinate.latitude != beacon2.location.coordinate.latitude ||
+        beacon1.location.coordinate.longitude != beacon2.location.coordinate.longitude) {
+        return NO;
+    }
+
+    if (beacon1.triggers.count != beacon2.triggers.count) {
+        return NO;
+    }
+
+    NSDictionary *triggers1 = [self triggersByIdentifier:beacon1.triggers];
+    for (BLETrigger *trigger2 in beacon2.triggers) {
+        BLETrigger *trigger1 = trigger2.uniqueIdentifier ? triggers1[trigger2.uniqueIdentifier] : nil;
+        if (!trigger1 || ![self isTrigger:trigger1 equalToTrigger:trigger2]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (BOOL) isTrigger:(BLETrigger *)trigger1 equalToTrigger:(BLETrigger *)trigger2
+{
+    if (!BLEZoneDiffEqualObjects(trigger1.uniqueIdentifier, trigger2.uniqueIdentifier) ||
+        !BLEZoneDiffEqualObjects(trigger1.name, trigger2.name) ||
+        !BLEZoneDiffEqualObjects(trigger1.comment, trigger2.comment)) {
+        return NO;
+    }
+
+    id <BLEAction> action1 = trigger1.action;
+    id <BLEAction> action2 = trigger2.action;
+    if (!BLEZoneDiffEqualObjects([action1 uniqueIdentifier], [action2 uniqueIdentifier]) ||
+        !BLEZoneDiffEqualObjects([action1 type], [action2 type]) ||
+        !BLEZoneDiffEqualObjects([action1 parameters], [action2 parameters])) {
+        return NO;
+    }
+
+    // conditions are all required, order doesn't matter
+    NSOrderedSet *conditions1 = trigger1.conditions;
+    NSOrderedSet *conditions2 = trigger2.conditions;
+    if (conditions1.count != conditions2.count) {
+        return NO;
+    }
+    NSMutableArray *unmatchedConditions = [NSMutableArray arrayWithCapacity:conditions1.count];
+    for (BLECondition *condition in conditions1) {
+        [unmatchedConditions addObject:condition];
+    }
+    for (BLECondition *condition in conditions2) {
+        NSUInteger index = [self indexOfCondition:condition inConditions:unmatchedConditions];
+        if (index == NSNotFound) {
+            return NO;
+        }
+        [unmatchedConditions removeObjectAtIndex:index];
+    }
+    return YES;
+}
+
+- (NSUInteger) indexOfCondition:(BLECondition *)condition inConditions:(NSArray *)conditions
+{
+    for (NSUInteger i = 0; i < conditions.count; i++) {
+        if ([self isCondition:conditions[i] equalToCondition:condition]) {
+            return i;
+        }
+    }
+    return NSNotFound;
+}
+
+- (BOOL) isCondition:(BLECondition *)condition1 equalToCondition:(BLECondition *)condition2
+{
+    return BLEZoneDiffEqualObjects(condition1.type, condition2.type) &&
+           BLEZoneDiffEqualObjects(condition1.expression, condition2.expression) &&
+           BLEZoneDiffEqualObjects(condition1.parameters, condition2.parameters);
+}
+
+- (NSDictionary *) triggersByIdentifier:(NSSet *)triggers
+{
+    NSMutableDictionary *triggersByIdentifier = [NSMutableDictionary dictionaryWithCapacity:triggers.count];
+    for (BLETrigger *trigger in triggers) {
+        if (trigger.uniqueIdentifier) {
+            triggersByIdentifier[trigger.uniqueIdentifier] = trigger;
+        }
+    }
+    return triggersByIdentifier;
+}
+
+#pragma mark - Apply
+
+- (void) apply
+{
+    for (BLEBeacon *beacon in self.beacons) {
+        beacon.zone = _zone;
+    }
+
+    for (BLEBeacon *beacon in self.updatedBeacons) {
+        BLEBeacon *replacement = [_replacements objectForKey:beacon];
+        beacon.name = replacement.name;
+        beacon.desc = replacement.desc;
+        beacon.parameters = replacement.parameters;
+        beacon.location = replacement.location;
+        beacon.triggers = [self mergeTriggers:beacon.triggers withTriggers:replacement.triggers forBeacon:beacon];
+    }
+}
+
+/**
+ *  Unchanged triggers are kept, changed triggers are moved to kept beacon with unchanged conditions reused.
+ */
+- (NSSet *) mergeTriggers:(NSSet *)loadedTriggers withTriggers:(NSSet *)triggers forBeacon:(BLEBeacon *)beacon
+{
+    NSDictionary *loadedByIdentifier = [self triggersByIdentifier:loadedTriggers];
+    NSMutableSet *mergedTriggers = [NSMutableSet setWithCapacity:triggers.count];
+    for (BLETrigger *trigger in triggers) {
+        BLETrigger *loadedTrigger = trigger.uniqueIdentifier ? loadedByIdentifier[trigger.uniqueIdentifier] : nil;
+        if (loadedTrigger && [self isTrigger:loadedTrigger equalToTrigger:trigger]) {
+            [mergedTriggers addObject:loadedTrigger];
+            continue;
+        }
+
+        trigger.beacon = beacon;
+        if (loadedTrigger) {
+            NSMutableOrderedSet *conditions = [NSMutableOrderedSet orderedSetWithCapacity:trigger.conditions.count];
+            NSMutableArray *loadedConditions = [NSMutableArray arrayWithCapacity:loadedTrigger.conditions.count];
+            for (BLECondition *loadedCondition in loadedTrigger.conditions) {
+                [loadedConditions addObject:loadedCondition];
+            }
+            for (BLECondition *condition in trigger.conditions) {
+                NSUInteger index = [self indexOfCondition:condition inConditions:loadedConditions];
+                if (index != NSNotFound) {
+                    // compiled already
+                    BLECondition *loadedCondition = loadedConditions[index];
+                    [loadedConditions removeObjectAtIndex:index];
+                    loadedCondition.trigger = trigger;
+                    [conditions addObject:loadedCondition];
+                } else {
+                    [conditions addObject:condition];
+                }
+            }
+            trigger.conditions = [conditions copy];
+        }
+        [mergedTriggers addObject:trigger];
+    }
+    return [mergedTriggers copy];
+}
+
+@end
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+@class BLEZone;
+
+/**
+ *  Error codes for zone parsing
+ */
+typedef NS_ENUM(NSInteger, BLEZoneParserError) {
+    BLEZoneParserErrorSyntax = 200,
+    BLEZoneParserErrorInvalidValue,
+    BLEZoneParserErrorInvalidBeaconIdentifier,
+    BLEZoneParserErrorRead
+};
+
+/**
+ *  Byte offset of the bad node, NSNumber
+ */
+extern NSString * const BLEZoneParserErrorOffsetKey;
+/**
+ *  Line of the bad node (1-based), NSNumber
+ */
+extern NSString * const BLEZoneParserErrorLineKey;
+/**
+ *  Column of the bad node (1-based), NSNumber
+ */
+extern NSString * const BLEZoneParserErrorColumnKey;
+/**
+ *  Path of the bad node, eg. beacons[3].triggers[0].conditions[1]
+ */
+extern NSString * const BLEZoneParserErrorPathKey;
+
+/**
+ *  Streaming zone JSON parser.
+ *
+ *  Reads input in small chunks and builds beacons one at a time, as soon as beacon object is read,
+ *  so only one beacon definition is kept in memory besides already built model objects.
+ *  Errors point to position (offset, line, column and path) of the bad node.
+ */
+@interface BLEZoneParser : NSObject
+
+/**
+ *  Initialize with JSON data
+ *
+ *  @param data JSON data
+ *
+ *  @return Initialized object
+ */
+- (instancetype) initWithData:(NSData *)data;
+
+/**
+ *  Initialize with stream, stream is opened and closed by parser
+ *
+ *  @param stream Input stream
+ *
+ *  @return Initialized object
+ */
+- (instancetype) initWithInputStream:(NSInputStream *)stream;
+
+/**
+ *  Parse zone and set properties of given zone
+ *
+ *  @param zone  Zone to update
+ *  @param error error or nil
+ *
+ *  @return YES on success
+ */
+- (BOOL) parseIntoZone:(BLEZone *)zone error:(NSError * __autoreleasing *)error;
+
+@end
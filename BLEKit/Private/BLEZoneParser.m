@@ -0,0 +1,715 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEZoneParser.h"
+#import "BLEKitPrivate.h"
+
+NSString * const BLEZoneParserErrorOffsetKey = @"BLEZoneParserErrorOffset";
+NSString * const BLEZoneParserErrorLineKey = @"BLEZoneParserErrorLine";
+NSString * const BLEZoneParserErrorColumnKey = @"BLEZoneParserErrorColumn";
+NSString * const BLEZoneParserErrorPathKey = @"BLEZoneParserErrorPath";
+
+/**
+ *  Size of chunk read from stream
+ */
+#define BLEZoneParserBufferSize 16384
+/**
+ *  Maximum nesting of objects and arrays
+ */
+#define BLEZoneParserMaxDepth 256
+
+typedef struct {
+    NSUInteger offset;
+    NSUInteger line;
+    NSUInteger column;
+} BLEZoneParserPosition;
+
+@implementation BLEZoneParser {
+    NSInputStream *_stream;
+    NSData *_data;
+    BOOL _streamEnded;
+
+    /**
+     *  Current chunk
+     */
+    const uint8_t *_bytes;
+    NSUInteger _length;
+    NSUInteger _position;
+    uint8_t _buffer[BLEZoneParserBufferSize];
+
+    /**
+     *  Offset of current chunk in input
+     */
+    NSUInteger _chunkOffset;
+    NSUInteger _line;
+    NSUInteger _column;
+
+    /**
+     *  Keys and indexes of nodes being parsed
+     */
+    NSMutableArray *_path;
+    NSUInteger _depth;
+
+    /**
+     *  Bytes of string or number being parsed
+     */
+    char *_scratch;
+    NSUInteger _scratchLength;
+    NSUInteger _scratchCapacity;
+
+    NSError *_error;
+}
+
+- (instancetype) initWithData:(NSData *)data
+{
+    if (self = [self init]) {
+        self->_data = data;
+        self->_bytes = data.bytes;
+        self->_length = data.length;
+        self->_streamEnded = YES;
+    }
+    return self;
+}
+
+- (instancetype) initWithInputStream:(NSInputStream *)stream
+{
+    NSParameterAssert(stream);
+
+    if (self = [self init]) {
+        self->_stream = stream;
+    }
+    return self;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        self->_line = 1;
+        self->_column = 1;
+        self->_path = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_scratch);
+}
+
+#pragma mark - Reader
+
+static BOOL BLEZoneParserFill(BLEZoneParser *parser)
+{
+    if (parser->_streamEnded) {
+        return NO;
+    }
+
+    parser->_chunkOffset += parser->_length;
+    parser->_position = 0;
+    parser->_length = 0;
+
+    NSInteger read = [parser->_stream read:parser->_buffer maxLength:BLEZoneParserBufferSize];
+    if (read <= 0) {
+        parser->_streamEnded = YES;
+        return NO;
+    }
+    parser->_bytes = parser->_buffer;
+    parser->_length = (NSUInteger)read;
+    return YES;
+}
+
+/**
+ *  Current byte or -1 at the end of input
+ */
+static inline int BLEZoneParserPeek(BLEZoneParser *parser)
+{
+    if (parser->_position < parser->_length || BLEZoneParserFill(parser)) {
+        return parser->_bytes[parser->_position];
+    }
+    return -1;
+}
+
+static inline int BLEZoneParserNext(BLEZoneParser *parser)
+{
+    int c = BLEZoneParserPeek(parser);
+    if (c < 0) {
+        return c;
+    }
+
+    parser->_position++;
+    if (c == '\n') {
+        parser->_line++;
+        parser->_column = 1;
+    } else if ((c & 0xC0) != 0x80) {
+        // count characters, not UTF-8 continuation bytes
+        parser->_column++;
+    }
+    return c;
+}
+
+static inline void BLEZoneParserSkipWhitespace(BLEZoneParser *parser)
+{
+    int c = BLEZoneParserPeek(parser);
+    while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+        BLEZoneParserNext(parser);
+        c = BLEZoneParserPeek(parser);
+    }
+}
+
+static inline BLEZoneParserPosition BLEZoneParserCurrentPosition(BLEZoneParser *parser)
+{
+    return (BLEZoneParserPosition){parser->_chunkOffset + parser->_position, parser->_line, parser->_column};
+}
+
+static inline void BLEZoneParserAppendScratch(BLEZoneParser *parser, char c)
+{
+    if (parser->_scratchLength == parser->_scratchCapacity) {
+        parser->_scratchCapacity = MAX(256, parser->_scratchCapacity * 2);
+        parser->_scratch = realloc(parser->_scratch, parser->_scratchCapacity);
+    }
+    parser->_scratch[parser->_scratchLength++] = c;
+}
+
+#pragma mark - Errors
+
+- (NSString *) pathString
+{
+    NSMutableString *path = [NSMutableString string];
+    for (id component in _path) {
+        if ([component isKindOfClass:[NSNumber class]]) {
+            [path appendFormat:@"[%@]", component];
+        } else {
+            [path appendString:path.length > 0 ? [@"." stringByAppendingString:component] : component];
+        }
+    }
+    return [path copy];
+}
+
+- (BOOL) failWithCode:(BLEZoneParserError)code reason:(NSString *)reason position:(BLEZoneParserPosition)position
+{
+    if (_error) {
+        return NO;
+    }
+
+    NSString *path = [self pathString];
+    NSMutableString *description = [NSMutableString stringWithFormat:@"%@ at line %@, column %@", reason, @(position.line), @(position.column)];
+    if (path.length > 0) {
+        [description appendFormat:@" (%@)", path];
+    }
+
+    _error = [NSError errorWithDomain:BLEErrorDomain code:code userInfo:@{NSLocalizedDescriptionKey: description,
+                                                                          BLEZoneParserErrorOffsetKey: @(position.offset),
+                                                                          BLEZoneParserErrorLineKey: @(position.line),
+                                                                          BLEZoneParserErrorColumnKey: @(position.column),
+                                                                          BLEZoneParserErrorPathKey: path}];
+    return NO;
+}
+
+- (BOOL) failWithReason:(NSString *)reason
+{
+    return [self failWithCode:BLEZoneParserErrorSyntax reason:reason position:BLEZoneParserCurrentPosition(self)];
+}
+
+- (BOOL) failUnexpectedCharacter:(int)c
+{
+    if (c < 0) {
+        return [self failWithReason:@"Unexpected end of data"];
+    }
+    if (c >= 0x20 && c < 0x7F) {
+        return [self failWithReason:[NSString stringWithFormat:@"Unexpected character '%c'", c]];
+    }
+    return [self failWithReason:[NSString stringWithFormat:@"Unexpected byte 0x%02x", c]];
+}
+
+#pragma mark - Structure
+
+/**
+ *  Parse object, block parses value of every member
+ */
+- (BOOL) parseObjectWithMemberBlock:(BOOL (^)(NSString *key))memberBlock
+{
+    BLEZoneParserSkipWhitespace(self);
+    int c = BLEZoneParserNext(self);
+    if (c != '{') {
+        return [self failUnexpectedCharacter:c];
+    }
+    if (++_depth > BLEZoneParserMaxDepth) {
+        return [self failWithReason:@"Too deep nesting"];
+    }
+
+    BLEZoneParserSkipWhitespace(self);
+    if (BLEZoneParserPeek(self) == '}') {
+        BLEZoneParserNext(self);
+        _depth--;
+        return YES;
+    }
+
+    while (YES) {
+        BLEZoneParserSkipWhitespace(self);
+        if (BLEZoneParserPeek(self) != '"') {
+            return [self failWithReason:@"Expected member name"];
+        }
+        NSString *key = [self parseString];
+        if (!key) {
+            return NO;
+        }
+
+        BLEZoneParserSkipWhitespace(self);
+        c = BLEZoneParserNext(self);
+        if (c != ':') {
+            return [self failUnexpectedCharacter:c];
+        }
+
+        [_path addObject:key];
+        if (!memberBlock(key)) {
+            return NO;
+        }
+        [_path removeLastObject];
+
+        BLEZoneParserSkipWhitespace(self);
+        c = BLEZoneParserNext(self);
+        if (c == '}') {
+            break;
+        }
+        if (c != ',') {
+            return [self failUnexpectedCharacter:c];
+        }
+    }
+
+    _depth--;
+    return YES;
+}
+
+/**
+ *  Parse array, block parses every element
+ */
+- (BOOL) parseArrayWithElementBlock:(BOOL (^)(NSUInteger index))elementBlock
+{
+    BLEZoneParserSkipWhitespace(self);
+    int c = BLEZoneParserNext(self);
+    if (c != '[') {
+        return [self failUnexpectedCharacter:c];
+    }
+    if (++_depth > BLEZoneParserMaxDepth) {
+        return [self failWithReason:@"Too deep nesting"];
+    }
+
+    BLEZoneParserSkipWhitespace(self);
+    if (BLEZoneParserPeek(self) == ']') {
+        BLEZoneParserNext(self);
+        _depth--;
+        return YES;
+    }
+
+    for (NSUInteger index = 0; ; index++) {
+        [_path addObject:@(index)];
+        if (!elementBlock(index)) {
+            return NO;
+        }
+        [_path removeLastObject];
+
+        BLEZoneParserSkipWhitespace(self);
+        c = BLEZoneParserNext(self);
+        if (c == ']') {
+            break;
+        }
+        if (c != ',') {
+            return [self failUnexpectedCharacter:c];
+        }
+    }
+
+    _depth--;
+    return YES;
+}
+
+#pragma mark - Values
+
+/**
+ *  Parse any value to Foundation objects, same as NSJSONSerialization
+ */
+- (id) parseValue
+{
+    BLEZoneParserSkipWhitespace(self);
+    int c = BLEZoneParserPeek(self);
+    switch (c) {
+        case '{': {
+            NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+            BOOL parsed = [self parseObjectWithMemberBlock:^BOOL(NSString *key) {
+                id value = [self parseValue];
+                if (value) {
+                    dictionary[key] = value;
+                }
+                return value != nil;
+            }];
+            return parsed ? dictionary : nil;
+        }
+        case '[': {
+            NSMutableArray *array = [NSMutableArray array];
+            BOOL parsed = [self parseArrayWithElementBlock:^BOOL(NSUInteger index) {
+                id value = [self parseValue];
+                if (value) {
+                    [array addObject:value];
+                }
+                return value != nil;
+            }];
+            return parsed ? array : nil;
+        }
+        case '"':
+            return [self parseString];
+        case 't':
+            return [self parseLiteral:"true"] ? @YES : nil;
+        case 'f':
+            return [self parseLiteral:"false"] ? @NO : nil;
+        case 'n':
+            return [self parseLiteral:"null"] ? [NSNull null] : nil;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                return [self parseNumber];
+            }
+            [self failUnexpectedCharacter:c];
+            return nil;
+    }
+}
+
+- (BOOL) parseLiteral:(const char *)literal
+{
+    for (const char *p = literal; *p; p++) {
+        if (BLEZoneParserPeek(self) != *p) {
+            return [self failUnexpectedCharacter:BLEZoneParserPeek(self)];
+        }
+        BLEZoneParserNext(self);
+    }
+    return YES;
+}
+
+- (NSString *) parseString
+{
+    BLEZoneParserNext(self); // "
+    _scratchLength = 0;
+
+    while (YES) {
+        int c = BLEZoneParserPeek(self);
+        if (c < 0) {
+            [self failWithReason:@"Unterminated string"];
+            return nil;
+        }
+        if (c < 0x20) {
+            [self failWithReason:@"Control character in string"];
+            return nil;
+        }
+        BLEZoneParserNext(self);
+
+        if (c == '"') {
+            break;
+        }
+        if (c != '\\') {
+            BLEZoneParserAppendScratch(self, (char)c);
+            continue;
+        }
+
+        c = BLEZoneParserNext(self);
+        switch (c) {
+            case '"':
+            case '\\':
+            case '/':
+                BLEZoneParserAppendScratch(self, (char)c);
+                break;
+            case 'b':
+                BLEZoneParserAppendScratch(self, '\b');
+                break;
+            case 'f':
+                BLEZoneParserAppendScratch(self, '\f');
+                break;
+            case 'n':
+                BLEZoneParserAppendScratch(self, '\n');
+                break;
+            case 'r':
+                BLEZoneParserAppendScratch(self, '\r');
+                break;
+            case 't':
+                BLEZoneParserAppendScratch(self, '\t');
+                break;
+            case 'u':
+                if (![self parseUnicodeEscape]) {
+                    return nil;
+                }
+                break;
+            default:
+                [self failWithReason:@"Invalid escape sequence"];
+                return nil;
+        }
+    }
+
+    NSString *string = [[NSString alloc] initWithBytes:_scratch length:_scratchLength encoding:NSUTF8StringEncoding];
+    if (!string) {
+        [self failWithReason:@"Invalid UTF-8 string"];
+    }
+    return string;
+}
+
+- (BOOL) parseHexQuad:(uint32_t *)value
+{
+    *value = 0;
+    for (NSUInteger i = 0; i < 4; i++) {
+        int c = BLEZoneParserNext(self);
+        uint32_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = (uint32_t)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = (uint32_t)(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            digit = (uint32_t)(c - 'A' + 10);
+        } else {
+            return [self failWithReason:@"Invalid unicode escape"];
+        }
+        *value = (*value << 4) | digit;
+    }
+    return YES;
+}
+
+/**
+ *  Parse \uXXXX (after \u), surrogate pairs included, and append UTF-8 bytes
+ */
+- (BOOL) parseUnicodeEscape
+{
+    uint32_t codePoint;
+    if (![self parseHexQuad:&codePoint]) {
+        return NO;
+    }
+
+    if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+        uint32_t low;
+        if (BLEZoneParserNext(self) != '\\' || BLEZoneParserNext(self) != 'u' || ![self parseHexQuad:&low] || low < 0xDC00 || low > 0xDFFF) {
+            return [self failWithReason:@"Invalid surrogate pair"];
+        }
+        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+    } else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+        return [self failWithReason:@"Invalid surrogate pair"];
+    }
+
+    if (codePoint < 0x80) {
+        BLEZoneParserAppendScratch(self, (char)codePoint);
+    } else if (codePoint < 0x800) {
+        BLEZoneParserAppendScratch(self, (char)(0xC0 | (codePoint >> 6)));
+        BLEZoneParserAppendScratch(self, (char)(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        BLEZoneParserAppendScratch(self, (char)(0xE0 | (codePoint >> 12)));
+        BLEZoneParserAppendScratch(self, (char)(0x80 | ((codePoint >> 6) & 0x3F)));
+        BLEZoneParserAppendScratch(self, (char)(0x80 | (codePoint & 0x3F)));
+    } else {
+        BLEZoneParserAppendScratch(self, (char)(0xF0 | (codePoint >> 18)));
+        BLEZoneParserAppendScratch(self, (char)(0x80 | ((codePoint >> 12) & 0x3F)));
+        BLEZoneParserAppendScratch(self, (char)(0x80 | ((codePoint >> 6) & 0x3F)));
+        BLEZoneParserAppendScratch(self, (char)(0x80 | (codePoint & 0x3F)));
+    }
+    return YES;
+}
+
+static inline BOOL BLEZoneParserAppendDigits(BLEZoneParser *parser)
+{
+    int c = BLEZoneParserPeek(parser);
+    if (c < '0' || c > '9') {
+        return NO;
+    }
+    while (c >= '0' && c <= '9') {
+        BLEZoneParserAppendScratch(parser, (char)BLEZoneParserNext(parser));
+        c = BLEZoneParserPeek(parser);
+    }
+    return YES;
+}
+
+- (NSNumber *) parseNumber
+{
+    _scratchLength = 0;
+    BOOL integer = YES;
+
+    if (BLEZoneParserPeek(self) == '-') {
+        BLEZoneParserAppendScratch(self, (char)BLEZoneParserNext(self));
+    }
+
+    if (BLEZoneParserPeek(self) == '0') {
+        BLEZoneParserAppendScratch(self, (char)BLEZoneParserNext(self));
+    } else if (!BLEZoneParserAppendDigits(self)) {
+        [self failWithReason:@"Invalid number"];
+        return nil;
+    }
+
+    if (BLEZoneParserPeek(self) == '.') {
+        integer = NO;
+        BLEZoneParserAppendScratch(self, (char)BLEZoneParserNext(self));
+        if (!BLEZoneParserAppendDigits(self)) {
+            [self failWithReason:@"Invalid number"];
+            return nil;
+        }
+    }
+
+    int c = BLEZoneParserPeek(self);
+    if (c == 'e' || c == 'E') {
+        integer = NO;
+        BLEZoneParserAppendScratch(self, (char)BLEZoneParserNext(self));
+        c = BLEZoneParserPeek(self);
+        if (c == '+' || c == '-') {
+            BLEZoneParserAppendScratch(self, (char)BLEZoneParserNext(self));
+        }
+        if (!BLEZoneParserAppendDigits(self)) {
+            [self failWithReason:@"Invalid number"];
+            return nil;
+        }
+    }
+    BLEZoneParserAppendScratch(self, '\0');
+
+    if (integer) {
+        errno = 0;
+        long long value = strtoll(_scratch, NULL, 10);
+        if (errno != ERANGE) {
+            return @(value);
+        }
+    }
+    return @(strtod(_scratch, NULL));
+}
+
+#pragma mark - Zone
+
+- (BOOL) parseIntoZone:(BLEZone *)zone error:(NSError * __autoreleasing *)error
+{
+    NSParameterAssert(zone);
+
+    if (!_stream && !_data) {
+        [self failWithCode:BLEZoneParserErrorRead reason:@"No data" position:BLEZoneParserCurrentPosition(self)];
+    } else {
+        [_stream open];
+        [self parseZone:zone];
+        if (_stream.streamStatus == NSStreamStatusError) {
+            // truncated input is reported as read error, not as syntax error
+            NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:@"Can't read zone" forKey:NSLocalizedDescriptionKey];
+            userInfo[NSUnderlyingErrorKey] = _stream.streamError;
+            _error = [NSError errorWithDomain:BLEErrorDomain code:BLEZoneParserErrorRead userInfo:userInfo];
+        }
+        [_stream close];
+    }
+
+    if (_error && error) {
+        *error = _error;
+    }
+    return _error == nil;
+}
+
+- (BOOL) parseZone:(BLEZone *)zone
+{
+    NSMutableDictionary *properties = [NSMutableDictionary dictionary];
+    __block NSMutableSet *beacons = nil;
+
+    BLEZoneParserSkipWhitespace(self);
+    if (BLEZoneParserPeek(self) != '{') {
+        return [self failWithCode:BLEZoneParserErrorInvalidValue reason:@"Expected zone object" position:BLEZoneParserCurrentPosition(self)];
+    }
+
+    // blocks are not retained, self can be used
+    BOOL parsed = [self parseObjectWithMemberBlock:^BOOL(NSString *key) {
+        if ([key isEqualToString:@"beacons"]) {
+            beacons = [NSMutableSet set];
+            return [self parseBeaconsForZone:zone intoSet:beacons];
+        }
+
+        id value = [self parseValue];
+        if (value) {
+            properties[key] = value;
+        }
+        return value != nil;
+    }];
+    if (!parsed) {
+        return NO;
+    }
+
+    BLEZoneParserSkipWhitespace(self);
+    if (BLEZoneParserPeek(self) >= 0) {
+        return [self failWithReason:@"Unexpected data after zone"];
+    }
+    [zone updatePropertiesFromDictionary:properties];
+    if (beacons) {
+        zone.beacons = [beacons copy];
+    }
+    return YES;
+}
+
+/**
+ *  Beacons are built one by one, definition of beacon is released as soon as beacon is built
+ */
+- (BOOL) parseBeaconsForZone:(BLEZone *)zone intoSet:(NSMutableSet *)beacons
+{
+    BLEZoneParserSkipWhitespace(self);
+    if (BLEZoneParserPeek(self) == 'n') {
+        return [self parseLiteral:"null"];
+    }
+    if (BLEZoneParserPeek(self) != '[') {
+        return [self failWithCode:BLEZoneParserErrorInvalidValue reason:@"Expected array of beacons" position:BLEZoneParserCurrentPosition(self)];
+    }
+
+    return [self parseArrayWithElementBlock:^BOOL(NSUInteger index) {
+        @autoreleasepool {
+            BLEBeacon *beacon = [self parseBeaconForZone:zone];
+            if (beacon) {
+                [beacons addObject:beacon];
+            }
+            return beacon != nil;
+        }
+    }];
+}
+
+- (BLEBeacon *) parseBeaconForZone:(BLEZone *)zone
+{
+    BLEZoneParserSkipWhitespace(self);
+    BLEZoneParserPosition position = BLEZoneParserCurrentPosition(self);
+    if (BLEZoneParserPeek(self) != '{') {
+        [self failWithCode:BLEZoneParserErrorInvalidValue reason:@"Expected beacon object" position:position];
+        return nil;
+    }
+
+    NSDictionary *dictionary = [self parseValue];
+    if (!dictionary) {
+        return nil;
+    }
+
+    BLEBeacon *beacon = [[BLEBeacon alloc] initWithZone:zone];
+    NSError *beaconError = nil;
+    @try {
+        if (![beacon updatePropertiesFromDictionary:dictionary error:&beaconError]) {
+            [_path addObject:@"id"];
+            [self failWithCode:BLEZoneParserErrorInvalidBeaconIdentifier reason:beaconError.localizedDescription position:position];
+            return nil;
+        }
+    }
+    @catch (NSException *exception) {
+        [self failWithCode:BLEZoneParserErrorInvalidValue reason:exception.reason ?: @"Invalid beacon" position:position];
+        return nil;
+    }
+    return beacon;
+}
+
+@end
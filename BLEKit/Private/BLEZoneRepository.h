@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+@class BLEZone;
+
+typedef void(^BLEZoneRepositoryCompletion)(BLEZone *zone, NSError *error);
+
+/**
+ *  Local cache of remote zones.
+ *
+ *  Last good zone payload is stored on disk with its ETag, Last-Modified and fetch date.
+ *  Zone within its time to life is served without request, expired zone is revalidated
+ *  with conditional request and parsed again only if content changed.
+ */
+@interface BLEZoneRepository : NSObject
+
+/**
+ *  Directory with cached zones
+ */
+@property (strong, readonly) NSString *path;
+
++ (instancetype) sharedRepository;
+
+/**
+ *  Initialize repository
+ *
+ *  @param path Directory with cached zones, created if needed
+ *
+ *  @return Initialized object
+ */
+- (instancetype) initWithPath:(NSString *)path;
+
+/**
+ *  Cached zone, loaded from snapshot only. JSON is never parsed here, so it's cheap on main thread.
+ *
+ *  @param zoneURL Zone URL
+ *  @param fresh   YES if zone is within its time to life
+ *
+ *  @return Zone or nil if zone is not cached
+ */
+- (BLEZone *) cachedZoneForURL:(NSURL *)zoneURL fresh:(BOOL *)fresh;
+
+/**
+ *  Fetch zone. Completion is called once on main queue: with cached zone if it is within time to life,
+ *  otherwise after revalidation. If request fails, expired cached zone is returned with error.
+ *
+ *  @param zoneURL    Zone URL
+ *  @param completion completion block
+ */
+- (void) fetchZoneFromURL:(NSURL *)zoneURL completion:(BLEZoneRepositoryCompletion)completion;
+
+/**
+ *  Revalidate zone regardless of its time to life. Completion is called on main queue with
+ *  the same cached zone instance if content didn't change.
+ *
+ *  @param cachedZone Zone returned by cachedZoneForURL:fresh: or nil
+ *  @param zoneURL    Zone URL
+ *  @param completion completion block
+ */
+- (void) revalidateZone:(BLEZone *)cachedZone fromURL:(NSURL *)zoneURL completion:(BLEZoneRepositoryCompletion)completion;
+
+/**
+ *  Remove cached zone
+ *
+ *  @param zoneURL Zone URL
+ */
+- (void) removeZoneForURL:(NSURL *)zoneURL;
+
+@end
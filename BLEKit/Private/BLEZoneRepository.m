@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEZoneRepository.h"
+#import "BLEZone.h"
+#import "BLEZoneSnapshot.h"
+#import "UNMutableURLRequest.h"
+#import "UNURLConnection.h"
+
+static NSString * const BLEZoneRepositoryURLKey = @"url";
+static NSString * const BLEZoneRepositoryETagKey = @"etag";
+static NSString * const BLEZoneRepositoryLastModifiedKey = @"lastModified";
+static NSString * const BLEZoneRepositoryFetchDateKey = @"fetchDate";
+
+@interface BLEZoneRepository ()
+@property (strong) dispatch_queue_t queue;
+/**
+ *  Completions waiting for request in progress, by cache key
+ */
+@property (strong) NSMutableDictionary *pendingCompletions;
+@end
+
+@implementation BLEZoneRepository
+
++ (instancetype) sharedRepository
+{
+    static BLEZoneRepository *sharedRepository = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *cachesPath = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+        NSString *path = [[cachesPath stringByAppendingPathComponent:@"com.up-next.BLEKit"] stringByAppendingPathComponent:@"remote"];
+        sharedRepository = [[BLEZoneRepository alloc] initWithPath:path];
+    });
+    return sharedRepository;
+}
+
+- (instancetype) initWithPath:(NSString *)path
+{
+    NSParameterAssert(path);
+
+    if (self = [super init]) {
+        self->_path = path;
+        self->_queue = dispatch_queue_create("com.up-next.BLEKit.zoneRepository", DISPATCH_QUEUE_SERIAL);
+        self->_pendingCompletions = [NSMutableDictionary dictionary];
+        [[NSFileManager defaultManager] createDirectoryAtPath:path withIntermediateDirectories:YES attributes:nil error:nil];
+    }
+    return self;
+}
+
+#pragma mark - Storage
+
+- (NSString *) keyForURL:(NSURL *)zoneURL
+{
+    // FNV-1a, stable between launches
+    NSData *data = [[zoneURL absoluteString] dataUsingEncoding:NSUTF8StringEncoding];
+    const uint8_t *bytes = data.bytes;
+    uint64_t hash = 14695981039346656037ull;
+    for (NSUInteger i = 0; i < data.length; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return [NSString stringWithFormat:@"%016llx", hash];
+}
+
+- (NSString *) jsonPathForKey:(NSString *)key
+{
+    return [self.path stringByAppendingPathComponent:[key stringByAppendingPathExtension:@"json"]];
+}
+
+- (NSString *) metadataPathForKey:(NSString *)key
+{
+    return [self.path stringByAppendingPathComponent:[key stringByAppendingPathExtension:@"plist"]];
+}
+
+- (NSDictionary *) metadataForKey:(NSString *)key
+{
+    return [NSDictionary dictionaryWithContentsOfFile:[self metadataPathForKey:key]];
+}
+
+- (void) setMetadata:(NSDictionary *)metadata forKey:(NSString *)key
+{
+    [metadata writeToFile:[self metadataPathForKey:key] atomically:YES];
+}
+
+- (void) removeZoneForURL:(NSURL *)zoneURL
+{
+    NSParameterAssert(zoneURL);
+
+    NSString *key = [self keyForURL:zoneURL];
+    dispatch_async(self.queue, ^{
+        [[NSFileManager defaultManager] removeItemAtPath:[self metadataPathForKey:key] error:nil];
+        [[NSFileManager defaultManager] removeItemAtPath:[self jsonPathForKey:key] error:nil];
+    });
+}
+
+/**
+ *  Metadata with validators of the response and current fetch date
+ */
+- (NSDictionary *) metadataForURL:(NSURL *)zoneURL response:(NSHTTPURLResponse *)response previous:(NSDictionary *)previous
+{
+    NSMutableDictionary *metadata = [NSMutableDictionary dictionaryWithDictionary:previous ?: @{}];
+    metadata[BLEZoneRepositoryURLKey] = [zoneURL absoluteString];
+    metadata[BLEZoneRepositoryFetchDateKey] = [NSDate date];
+
+    NSDictionary *headers = response.allHeaderFields;
+    for (NSString *header in headers) {
+        if ([header caseInsensitiveCompare:@"ETag"] == NSOrderedSame) {
+            metadata[BLEZoneRepositoryETagKey] = headers[header];
+        } else if ([header caseInsensitiveCompare:@"Last-Modified"] == NSOrderedSame) {
+            metadata[BLEZoneRepositoryLastModifiedKey] = headers[header];
+        }
+    }
+    return [metadata copy];
+}
+
+- (BOOL) isFreshZone:(BLEZone *)zone metadata:(NSDictionary *)metadata
+{
+    NSDate *fetchDate = metadata[BLEZoneRepositoryFetchDateKey];
+    if (!zone || zone.timeToLife <= 0 || ![fetchDate isKindOfClass:[NSDate class]]) {
+        return NO;
+    }
+
+    NSTimeInterval age = -[fetchDate timeIntervalSinceNow];
+    return age >= 0 && age < zone.timeToLife;
+}
+
+#pragma mark - Fetch
+
+- (BLEZone *) cachedZoneForURL:(NSURL *)zoneURL fresh:(BOOL *)fresh
+{
+    NSParameterAssert(zoneURL);
+
+    NSString *key = [self keyForURL:zoneURL];
+    NSDictionary *metadata = [self metadataForKey:key];
+    BLEZone *zone = metadata ? [BLEZoneSnapshot cachedZoneForJSONAtPath:[self jsonPathForKey:key]] : nil;
+    if (fresh) {
+        *fresh = [self isFreshZone:zone metadata:metadata];
+    }
+    return zone;
+}
+
+/**
+ *  Add completion for request
+ *
+ *  @return YES if there is no request in progress for key
+ */
+- (BOOL) addCompletion:(BLEZoneRepositoryCompletion)completion forKey:(NSString *)key
+{
+    if (!completion) {
+        completion = ^(BLEZone *zone, NSError *error) {};
+    }
+    @synchronized(self) {
+        NSMutableArray *completions = self.pendingCompletions[key];
+        if (completions) {
+            [completions addObject:[completion copy]];
+            return NO;
+        }
+        self.pendingCompletions[key] = [NSMutableArray arrayWithObject:[completion copy]];
+        return YES;
+    }
+}
+
+- (void) fetchZoneFromURL:(NSURL *)zoneURL completion:(BLEZoneRepositoryCompletion)completion
+{
+    NSParameterAssert(zoneURL);
+
+    NSString *key = [self keyForURL:zoneURL];
+    if (![self addCompletion:completion forKey:key]) {
+        return;
+    }
+
+    dispatch_async(self.queue, ^{
+        NSDictionary *metadata = [self metadataForKey:key];
+        BLEZone *cachedZone = metadata ? [BLEZoneSnapshot zoneWithJSONAtPath:[self jsonPathForKey:key] error:nil] : nil;
+        if (!cachedZone) {
+            metadata = nil;
+        }
+
+        if ([self isFreshZone:cachedZone metadata:metadata]) {
+            [self finishKey:key zone:cachedZone error:nil];
+            return;
+        }
+
+        [self revalidateZone:cachedZone fromURL:zoneURL key:key metadata:metadata];
+    });
+}
+
+- (void) revalidateZone:(BLEZone *)cachedZone fromURL:(NSURL *)zoneURL completion:(BLEZoneRepositoryCompletion)completion
+{
+    NSParameterAssert(zoneURL);
+
+    NSString *key = [self keyForURL:zoneURL];
+    if (![self addCompletion:completion forKey:key]) {
+        return;
+    }
+
+    dispatch_async(self.queue, ^{
+        // validators are valid for cached zone only
+        NSDictionary *metadata = cachedZone ? [self metadataForKey:key] : nil;
+        [self revalidateZone:cachedZone fromURL:zoneURL key:key metadata:metadata];
+    });
+}
+
+- (void) revalidateZone:(BLEZone *)cachedZone fromURL:(NSURL *)zoneURL key:(NSString *)key metadata:(NSDictionary *)metadata
+{
+    UNMutableURLRequest *request = [[UNMutableURLRequest alloc] initWithGetURL:zoneURL parameters:nil];
+    if (metadata[BLEZoneRepositoryETagKey]) {
+        [request setValue:metadata[BLEZoneRepositoryETagKey] forHTTPHeaderField:@"If-None-Match"];
+    }
+    if (metadata[BLEZoneRepositoryLastModifiedKey]) {
+        [request setValue:metadata[BLEZoneRepositoryLastModifiedKey] forHTTPHeaderField:@"If-Modified-Since"];
+    }
+
+    __weak typeof(self)selfWeak = self;
+    UNURLConnection *connection = [UNURLConnection connectionWithRequest:request completion:^(NSHTTPURLResponse *response, NSData *responseData, NSError *errorRequest) {
+        typeof(self) selfStrong = selfWeak;
+        if (!selfStrong) {
+            return;
+        }
+        dispatch_async(selfStrong.queue, ^{
+            [selfStrong handleResponse:response data:responseData error:errorRequest cachedZone:cachedZone fromURL:zoneURL key:key metadata:metadata];
+        });
+    }];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [connection start];
+    });
+}
+
+- (void) handleResponse:(NSHTTPURLResponse *)response data:(NSData *)responseData error:(NSError *)errorRequest cachedZone:(BLEZone *)cachedZone fromURL:(NSURL *)zoneURL key:(NSString *)key metadata:(NSDictionary *)metadata
+{
+    NSString *jsonPath = [self jsonPathForKey:key];
+    NSInteger statusCode = [response isKindOfClass:[NSHTTPURLResponse class]] ? response.statusCode : 200;
+
+    if (!errorRequest && cachedZone && statusCode == 304) {
+        // not modified
+        [self setMetadata:[self metadataForURL:zoneURL response:response previous:metadata] forKey:key];
+        [self finishKey:key zone:cachedZone error:nil];
+        return;
+    }
+
+    if (errorRequest || statusCode < 200 || statusCode >= 300 || responseData.length == 0) {
+        NSError *error = errorRequest ?: [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadServerResponse userInfo:@{NSURLErrorFailingURLErrorKey: zoneURL}];
+        [self finishKey:key zone:cachedZone error:error];
+        return;
+    }
+
+    NSDictionary *updatedMetadata = [self metadataForURL:zoneURL response:response previous:nil];
+    if (cachedZone && [responseData isEqualToData:[NSData dataWithContentsOfFile:jsonPath options:NSDataReadingMappedIfSafe error:nil]]) {
+        // same content, server doesn't support validators
+        [self setMetadata:updatedMetadata forKey:key];
+        [self finishKey:key zone:cachedZone error:nil];
+        return;
+    }
+
+    NSError *error = nil;
+    BLEZone *zone = [BLEZone zoneWithJSON:responseData error:&error];
+    if (!zone) {
+        [self finishKey:key zone:cachedZone error:error];
+        return;
+    }
+
+    if ([responseData writeToFile:jsonPath atomically:YES]) {
+        [self setMetadata:updatedMetadata forKey:key];
+    }
+    [self finishKey:key zone:zone error:nil];
+}
+
+- (void) finishKey:(NSString *)key zone:(BLEZone *)zone error:(NSError *)error
+{
+    NSArray *completions = nil;
+    @synchronized(self) {
+        completions = self.pendingCompletions[key];
+        [self.pendingCompletions removeObjectForKey:key];
+    }
+
+    dispatch_async(dispatch_get_main_queue(), ^{
+        for (BLEZoneRepositoryCompletion completion in completions) {
+            completion(zone, error);
+        }
+    });
+}
+
+@end
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+@class BLEZone;
+
+/**
+ *  Version of snapshot layout, snapshot of other version is ignored
+ */
+#define BLEZoneSnapshotVersion 1
+
+/**
+ *  Error codes for snapshot loading
+ */
+typedef NS_ENUM(NSInteger, BLEZoneSnapshotError) {
+    BLEZoneSnapshotErrorInvalid = 400
+};
+
+/**
+ *  Size and modification time of the JSON the snapshot was compiled from
+ */
+typedef struct {
+    uint64_t size;
+    NSTimeInterval modificationTime;
+} BLEZoneSnapshotSourceStamp;
+
+/**
+ *  Compiled binary zone.
+ *
+ *  Snapshot holds interned strings, packed beacon keys, compiled condition bytecode and encoded parameters,
+ *  so loading doesn't parse JSON, identifiers or expressions. Beacon and action parameters are decoded
+ *  on first access.
+ */
+@interface BLEZoneSnapshot : NSObject
+
+/**
+ *  Compile zone to snapshot
+ *
+ *  @param zone  Zone
+ *  @param stamp Source JSON stamp, checked before cached snapshot is used
+ *
+ *  @return Snapshot data
+ */
++ (NSData *) dataWithZone:(BLEZone *)zone sourceStamp:(BLEZoneSnapshotSourceStamp)stamp;
+
+/**
+ *  Load zone from snapshot
+ *
+ *  @param data  Snapshot data
+ *  @param error error or nil
+ *
+ *  @return Zone or nil if snapshot is invalid
+ */
++ (BLEZone *) zoneWithData:(NSData *)data error:(NSError * __autoreleasing *)error;
+
+/**
+ *  Load zone from cached snapshot of JSON file. If there is no snapshot or JSON changed,
+ *  JSON is parsed and snapshot is written in background.
+ *
+ *  @param jsonPath Path to zone JSON
+ *  @param error    error or nil
+ *
+ *  @return Zone
+ */
++ (BLEZone *) zoneWithJSONAtPath:(NSString *)jsonPath error:(NSError * __autoreleasing *)error;
+
+/**
+ *  Load zone from cached snapshot of JSON file only, JSON is never parsed.
+ *
+ *  @param jsonPath Path to zone JSON
+ *
+ *  @return Zone or nil if there is no valid snapshot
+ */
++ (BLEZone *) cachedZoneForJSONAtPath:(NSString *)jsonPath;
+
+#ifdef DEBUG
+/**
+ *  Compare JSON and snapshot load time, result is logged
+ *
+ *  @param jsonPath   Path to zone JSON
+ *  @param iterations Number of loads of each kind
+ */
++ (void) benchmarkZoneAtPath:(NSString *)jsonPath iterations:(NSUInteger)iterations;
+#endif
+
+@end
@@ -0,0 +1,820 @@
+/*
+ * Copyright (c) 2014 UP-NEXT. All rights reserved.
+ * http://www.up-next.com
+ *
+ * Marcin Krzyżanowski <marcink@up-next.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#import "BLEZoneSnapshot.h"
+#import "BLEKitPrivate.h"
+#import "BLEConditionExpression.h"
+#import "BLEMonotonicClock.h"
+
+#define BLEZoneSnapshotMagic 0x535A4C42 // BLZS
+/**
+ *  Maximum nesting of parameter values
+ */
+#define BLEZoneSnapshotMaxDepth 64
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t bytecodeVersion;
+    /**
+     *  Checksum of everything after header
+     */
+    uint32_t checksum;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    double sourceModificationTime;
+} BLEZoneSnapshotHeader;
+
+typedef NS_ENUM(uint8_t, BLEZoneSnapshotValueTag) {
+    BLEZoneSnapshotValueNil = 0,
+    BLEZoneSnapshotValueNull,
+    BLEZoneSnapshotValueFalse,
+    BLEZoneSnapshotValueTrue,
+    BLEZoneSnapshotValueInteger,    // zigzag varint
+    BLEZoneSnapshotValueDouble,     // 8 bytes
+    BLEZoneSnapshotValueString,     // string table reference
+    BLEZoneSnapshotValueArray,      // count, values
+    BLEZoneSnapshotValueDictionary  // count, (key reference, value)
+};
+
+/**
+ *  How parameters are stored
+ */
+typedef NS_ENUM(uint8_t, BLEZoneSnapshotParameters) {
+    BLEZoneSnapshotParametersNil = 0,
+    /**
+     *  Dictionary decoded on first access, length and encoded value
+     */
+    BLEZoneSnapshotParametersLazy,
+    /**
+     *  Any other value
+     */
+    BLEZoneSnapshotParametersValue
+};
+
+static uint32_t BLEZoneSnapshotChecksum(const uint8_t *bytes, NSUInteger length)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (NSUInteger i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+#pragma mark - Reader
+
+typedef struct {
+    __unsafe_unretained NSData *data;
+    __unsafe_unretained NSArray *strings;
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+    BOOL failed;
+} BLEZoneSnapshotReader;
+
+static inline BOOL BLEZoneSnapshotReadBytes(BLEZoneSnapshotReader *reader, void *bytes, NSUInteger length)
+{
+    if (reader->failed || reader->length - reader->offset < length) {
+        reader->failed = YES;
+        return NO;
+    }
+    memcpy(bytes, reader->bytes + reader->offset, length);
+    reader->offset += length;
+    return YES;
+}
+
+static inline uint8_t BLEZoneSnapshotReadByte(BLEZoneSnapshotReader *reader)
+{
+    uint8_t byte = 0;
+    BLEZoneSnapshotReadBytes(reader, &byte, sizeof(byte));
+    return byte;
+}
+
+static inline uint64_t BLEZoneSnapshotReadVarint(BLEZoneSnapshotReader *reader)
+{
+    uint64_t value = 0;
+    for (NSUInteger shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = BLEZoneSnapshotReadByte(reader);
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80) || reader->failed) {
+            return value;
+        }
+    }
+    reader->failed = YES;
+    return 0;
+}
+
+/**
+ *  Count of elements, every element takes at least one byte
+ */
+static inline NSUInteger BLEZoneSnapshotReadCount(BLEZoneSnapshotReader *reader)
+{
+    uint64_t count = BLEZoneSnapshotReadVarint(reader);
+    if (count > reader->length - reader->offset) {
+        reader->failed = YES;
+        return 0;
+    }
+    return (NSUInteger)count;
+}
+
+static inline NSString *BLEZoneSnapshotReadString(BLEZoneSnapshotReader *reader)
+{
+    uint64_t reference = BLEZoneSnapshotReadVarint(reader);
+    if (reference == 0 || reference > reader->strings.count) {
+        reader->failed = YES;
+        return nil;
+    }
+    return reader->strings[(NSUInteger)reference - 1];
+}
+
+static id BLEZoneSnapshotReadValue(BLEZoneSnapshotReader *reader, NSUInteger depth)
+{
+    if (depth > BLEZoneSnapshotMaxDepth) {
+        reader->failed = YES;
+        return nil;
+    }
+
+    switch (BLEZoneSnapshotReadByte(reader)) {
+        case BLEZoneSnapshotValueNil:
+            return nil;
+        case BLEZoneSnapshotValueNull:
+            return [NSNull null];
+        case BLEZoneSnapshotValueFalse:
+            return @NO;
+        case BLEZoneSnapshotValueTrue:
+            return @YES;
+        case BLEZoneSnapshotValueInteger: {
+            uint64_t zigzag = BLEZoneSnapshotReadVarint(reader);
+            return @((long long)((zigzag >> 1) ^ -(zigzag & 1)));
+        }
+        case BLEZoneSnapshotValueDouble: {
+            double value = 0;
+            BLEZoneSnapshotReadBytes(reader, &value, sizeof(value));
+            return @(value);
+        }
+        case BLEZoneSnapshotValueString:
+            return BLEZoneSnapshotReadString(reader);
+        case BLEZoneSnapshotValueArray: {
+            NSUInteger count = BLEZoneSnapshotReadCount(reader);
+            NSMutableArray *array = [NSMutableArray arrayWithCapacity:count];
+            for (NSUInteger i = 0; i < count && !reader->failed; i++) {
+                id value = BLEZoneSnapshotReadValue(reader, depth + 1);
+                if (value) {
+                    [array addObject:value];
+                }
+            }
+            return reader->failed ? nil : [array copy];
+        }
+        case BLEZoneSnapshotValueDictionary: {
+            NSUInteger count = BLEZoneSnapshotReadCount(reader);
+            NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:count];
+            for (NSUInteger i = 0; i < count && !reader->failed; i++) {
+                NSString *key = BLEZoneSnapshotReadString(reader);
+                id value = BLEZoneSnapshotReadValue(reader, depth + 1);
+                if (key && value) {
+                    dictionary[key] = value;
+                }
+            }
+            return reader->failed ? nil : [dictionary copy];
+        }
+        default:
+            reader->failed = YES;
+            return nil;
+    }
+}
+
+/**
+ *  Length prefixed bytes, not copied
+ */
+static inline NSRange BLEZoneSnapshotReadBlob(BLEZoneSnapshotReader *reader)
+{
+    uint64_t length = BLEZoneSnapshotReadVarint(reader);
+    if (reader->failed || length > reader->length - reader->offset) {
+        reader->failed = YES;
+        return NSMakeRange(0, 0);
+    }
+    NSRange range = NSMakeRange(reader->offset, (NSUInteger)length);
+    reader->offset += (NSUInteger)length;
+    return range;
+}
+
+#pragma mark - Lazy parameters
+
+/**
+ *  Dictionary decoded from snapshot on first access
+ */
+@interface BLEZoneSnapshotDictionary : NSDictionary
+- (instancetype) initWithData:(NSData *)data range:(NSRange)range strings:(NSArray *)strings;
+@end
+
+@implementation BLEZoneSnapshotDictionary {
+    NSData *_data;
+    NSRange _range;
+    NSArray *_strings;
+    NSDictionary *_dictionary;
+}
+
+- (instancetype) initWithData:(NSData *)data range:(NSRange)range strings:(NSArray *)strings
+{
+    if (self = [super init]) {
+        self->_data = data;
+        self->_range = range;
+        self->_strings = strings;
+    }
+    return self;
+}
+
+- (NSDictionary *) dictionary
+{
+    @synchronized(self) {
+        if (!_dictionary) {
+            BLEZoneSnapshotReader reader = {_data, _strings, _data.bytes, NSMaxRange(_range), _range.location, NO};
+            id value = BLEZoneSnapshotReadValue(&reader, 0);
+            _dictionary = [value isKindOfClass:[NSDictionary class]] ? value : @{};
+            _data = nil;
+            _strings = nil;
+        }
+        return _dictionary;
+    }
+}
+
+- (NSUInteger)count
+{
+    return [[self dictionary] count];
+}
+
+- (id)objectForKey:(id)aKey
+{
+    return [[self dictionary] objectForKey:aKey];
+}
+
+- (NSEnumerator *)keyEnumerator
+{
+    return [[self dictionary] keyEnumerator];
+}
+
+- (Class)classForCoder
+{
+    return [NSDictionary class];
+}
+
+- (Class)classForKeyedArchiver
+{
+    return [NSDictionary class];
+}
+
+@end
+
+#pragma mark - Writer
+
+@interface BLEZoneSnapshotWriter : NSObject
+- (void) writeZone:(BLEZone *)zone;
+- (NSData *) dataWithSourceStamp:(BLEZoneSnapshotSourceStamp)stamp;
+@end
+
+@implementation BLEZoneSnapshotWriter {
+    NSMutableData *_body;
+    NSMutableArray *_strings;
+    NSMutableDictionary *_stringReferences;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        self->_body = [NSMutableData data];
+        self->_strings = [NSMutableArray array];
+        self->_stringReferences = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (void) writeByte:(uint8_t)byte
+{
+    [_body appendBytes:&byte length:sizeof(byte)];
+}
+
+- (void) writeVarint:(uint64_t)value
+{
+    uint8_t bytes[10];
+    NSUInteger length = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        bytes[length++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    [_body appendBytes:bytes length:length];
+}
+
+- (void) writeDouble:(double)value
+{
+    [_body appendBytes:&value length:sizeof(value)];
+}
+
+- (void) writeBlob:(NSData *)data
+{
+    [self writeVarint:data.length];
+    [_body appendData:data];
+}
+
+/**
+ *  Intern string, write reference
+ */
+- (void) writeString:(NSString *)string
+{
+    NSNumber *reference = _stringReferences[string];
+    if (!reference) {
+        [_strings addObject:string];
+        reference = @(_strings.count);
+        _stringReferences[string] = reference;
+    }
+    [self writeVarint:[reference unsignedLongLongValue]];
+}
+
+- (void) writeValue:(id)value
+{
+    if (!value) {
+        [self writeByte:BLEZoneSnapshotValueNil];
+    } else if ([value isKindOfClass:[NSNull class]]) {
+        [self writeByte:BLEZoneSnapshotValueNull];
+    } else if ([value isKindOfClass:[NSString class]]) {
+        [self writeByte:BLEZoneSnapshotValueString];
+        [self writeString:value];
+    } else if ([value isKindOfClass:[NSNumber class]]) {
+        const char *type = [value objCType];
+        if (CFGetTypeID((__bridge CFTypeRef)value) == CFBooleanGetTypeID()) {
+            [self writeByte:[value boolValue] ? BLEZoneSnapshotValueTrue : BLEZoneSnapshotValueFalse];
+        } else if (strcmp(type, @encode(double)) == 0 || strcmp(type, @encode(float)) == 0) {
+            [self writeByte:BLEZoneSnapshotValueDouble];
+            [self writeDouble:[value doubleValue]];
+        } else {
+            long long integer = [value longLongValue];
+            [self writeByte:BLEZoneSnapshotValueInteger];
+            [self writeVarint:((uint64_t)integer << 1) ^ (uint64_t)(integer >> 63)];
+        }
+    } else if ([value isKindOfClass:[NSArray class]]) {
+        [self writeByte:BLEZoneSnapshotValueArray];
+        [self writeVarint:[value count]];
+        for (id element in value) {
+            [self writeValue:element];
+        }
+    } else if ([value isKindOfClass:[NSDictionary class]]) {
+        [self writeByte:BLEZoneSnapshotValueDictionary];
+        [self writeVarint:[value count]];
+        [value enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
+            [self writeString:[key description]];
+            [self writeValue:obj];
+        }];
+    } else {
+        [self writeByte:BLEZoneSnapshotValueString];
+        [self writeString:[value description]];
+    }
+}
+
+- (void) writeParameters:(id)parameters
+{
+    if (!parameters) {
+        [self writeByte:BLEZoneSnapshotParametersNil];
+    } else if ([parameters isKindOfClass:[NSDictionary class]]) {
+        // encode separately, decoded on first access
+        NSMutableData *body = _body;
+        _body = [NSMutableData data];
+        [self writeValue:parameters];
+        NSData *encoded = _body;
+        _body = body;
+
+        [self writeByte:BLEZoneSnapshotParametersLazy];
+        [self writeBlob:encoded];
+    } else {
+        [self writeByte:BLEZoneSnapshotParametersValue];
+        [self writeValue:parameters];
+    }
+}
+
+- (void) writeLocation:(BLELocation *)location
+{
+    [self writeByte:location ? 1 : 0];
+    if (location) {
+        [self writeDouble:location.coordinate.latitude];
+        [self writeDouble:location.coordinate.longitude];
+    }
+}
+
+- (void) writeZone:(BLEZone *)zone
+{
+    [self writeValue:zone.identifier];
+    [self writeValue:zone.name];
+    [self writeValue:zone.desc];
+    [self writeValue:@(zone.timeToLife)];
+    [self writeLocation:zone.location];
+
+    // count + 1, 0 for nil
+    NSSet *beacons = zone.beacons;
+    [self writeVarint:beacons ? beacons.count + 1 : 0];
+    for (BLEBeacon *beacon in beacons) {
+        [self writeBeacon:beacon];
+    }
+}
+
+- (void) writeBeacon:(BLEBeacon *)beacon
+{
+    if (beacon.proximityUUID) {
+        BLEBeaconKey key = [beacon beaconKey];
+        [self writeByte:1];
+        [_body appendBytes:key.proximityUUID length:sizeof(uuid_t)];
+        [_body appendBytes:&key.major length:sizeof(key.major)];
+        [_body appendBytes:&key.minor length:sizeof(key.minor)];
+        [self writeByte:key.fields];
+    } else {
+        [self writeByte:0];
+    }
+
+    [self writeValue:beacon.name];
+    [self writeValue:beacon.desc];
+    [self writeParameters:beacon.parameters];
+    [self writeLocation:beacon.location];
+
+    NSSet *triggers = beacon.triggers;
+    [self writeVarint:triggers ? triggers.count + 1 : 0];
+    for (BLETrigger *trigger in triggers) {
+        [self writeTrigger:trigger];
+    }
+}
+
+- (void) writeTrigger:(BLETrigger *)trigger
+{
+    [self writeValue:trigger.uniqueIdentifier];
+    [self writeValue:trigger.name];
+    [self writeValue:trigger.comment];
+
+    id <BLEAction> action = trigger.action;
+    NSString *actionIdentifier = [action uniqueIdentifier];
+    [self writeByte:actionIdentifier ? 1 : 0];
+    if (actionIdentifier) {
+        [self writeValue:actionIdentifier];
+        [self writeValue:[action type]];
+        [self writeParameters:[action parameters]];
+    }
+
+    id conditions = trigger.conditions;
+    [self writeVarint:conditions ? [conditions count] + 1 : 0];
+    for (BLECondition *condition in conditions) {
+        [self writeValue:condition.type];
+        [self writeValue:condition.expression];
+        [self writeValue:condition.parameters];
+        [self writeBlob:[[condition nativeExpression] bytecode]];
+        [self writeBlob:[[condition nativeParameters] bytecode]];
+        [self writeBlob:[[condition nativeParametersWithoutOccurrence] bytecode]];
+    }
+}
+
+- (NSData *) dataWithSourceStamp:(BLEZoneSnapshotSourceStamp)stamp
+{
+    NSMutableData *data = [NSMutableData dataWithLength:sizeof(BLEZoneSnapshotHeader)];
+
+    // string table goes first, body references it
+    NSMutableData *body = _body;
+    _body = data;
+    [self writeVarint:_strings.count];
+    for (NSString *string in _strings) {
+        [self writeBlob:[string dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    [data appendData:body];
+    _body = body;
+
+    BLEZoneSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = BLEZoneSnapshotMagic;
+    header.version = BLEZoneSnapshotVersion;
+    header.bytecodeVersion = BLEConditionExpressionBytecodeVersion;
+    header.sourceSize = stamp.size;
+    header.sourceModificationTime = stamp.modificationTime;
+    header.checksum = BLEZoneSnapshotChecksum((const uint8_t *)data.bytes + sizeof(header), data.length - sizeof(header));
+    [data replaceBytesInRange:NSMakeRange(0, sizeof(header)) withBytes:&header];
+    return [data copy];
+}
+
+@end
+
+#pragma mark - Snapshot
+
+@implementation BLEZoneSnapshot
+
++ (NSData *) dataWithZone:(BLEZone *)zone sourceStamp:(BLEZoneSnapshotSourceStamp)stamp
+{
+    NSParameterAssert(zone);
+
+    BLEZoneSnapshotWriter *writer = [[BLEZoneSnapshotWriter alloc] init];
+    [writer writeZone:zone];
+    return [writer dataWithSourceStamp:stamp];
+}
+
++ (BOOL) readHeader:(BLEZoneSnapshotHeader *)header fromData:(NSData *)data
+{
+    if (data.length < sizeof(BLEZoneSnapshotHeader)) {
+        return NO;
+    }
+    memcpy(header, data.bytes, sizeof(BLEZoneSnapshotHeader));
+    return header->magic == BLEZoneSnapshotMagic && header->version == BLEZoneSnapshotVersion && header->bytecodeVersion == BLEConditionExpressionBytecodeVersion;
+}
+
++ (BLEZone *) zoneWithData:(NSData *)data error:(NSError * __autoreleasing *)error
+{
+    BLEZoneSnapshotHeader header;
+    BLEZone *zone = nil;
+    if ([self readHeader:&header fromData:data] &&
+        header.checksum == BLEZoneSnapshotChecksum((const uint8_t *)data.bytes + sizeof(header), data.length - sizeof(header))) {
+        zone = [self readZoneFromData:data];
+    }
+
+    if (!zone && error) {
+        *error = [NSError errorWithDomain:BLEErrorDomain code:BLEZoneSnapshotErrorInvalid userInfo:@{NSLocalizedDescriptionKey: @"Invalid zone snapshot"}];
+    }
+    return zone;
+}
+
++ (BLEZone *) readZoneFromData:(NSData *)data
+{
+    BLEZoneSnapshotReader reader = {data, nil, data.bytes, data.length, sizeof(BLEZoneSnapshotHeader), NO};
+
+    NSUInteger stringsCount = BLEZoneSnapshotReadCount(&reader);
+    NSMutableArray *strings = [NSMutableArray arrayWithCapacity:stringsCount];
+    for (NSUInteger i = 0; i < stringsCount && !reader.failed; i++) {
+        NSRange range = BLEZoneSnapshotReadBlob(&reader);
+        NSString *string = reader.failed ? nil : [[NSString alloc] initWithBytes:reader.bytes + range.location length:range.length encoding:NSUTF8StringEncoding];
+        if (!string) {
+            return nil;
+        }
+        [strings addObject:string];
+    }
+    reader.strings = strings;
+
+    BLEZone *zone = [[BLEZone alloc] init];
+    zone.identifier = BLEZoneSnapshotReadValue(&reader, 0);
+    zone.name = BLEZoneSnapshotReadValue(&reader, 0);
+    zone.desc = BLEZoneSnapshotReadValue(&reader, 0);
+    zone.timeToLife = [BLEZoneSnapshotReadValue(&reader, 0) integerValue];
+    zone.location = [self readLocation:&reader];
+
+    NSUInteger beaconsCount = BLEZoneSnapshotReadCount(&reader);
+    if (beaconsCount > 0) {
+        NSMutableSet *beacons = [NSMutableSet setWithCapacity:beaconsCount - 1];
+        for (NSUInteger i = 0; i < beaconsCount - 1 && !reader.failed; i++) {
+            @autoreleasepool {
+                [beacons addObject:[self readBeaconForZone:zone reader:&reader]];
+            }
+        }
+        zone.beacons = [beacons copy];
+    }
+
+    if (reader.failed || reader.offset != reader.length) {
+        return nil;
+    }
+    return zone;
+}
+
++ (BLELocation *) readLocation:(BLEZoneSnapshotReader *)reader
+{
+    if (!BLEZoneSnapshotReadByte(reader)) {
+        return nil;
+    }
+    double latitude = 0, longitude = 0;
+    BLEZoneSnapshotReadBytes(reader, &latitude, sizeof(latitude));
+    BLEZoneSnapshotReadBytes(reader, &longitude, sizeof(longitude));
+
+    BLELocation *location = [[BLELocation alloc] init];
+    location.coordinate = CLLocationCoordinate2DMake(latitude, longitude);
+    return location;
+}
+
++ (id) readParameters:(BLEZoneSnapshotReader *)reader
+{
+    switch (BLEZoneSnapshotReadByte(reader)) {
+        case BLEZoneSnapshotParametersNil:
+            return nil;
+        case BLEZoneSnapshotParametersLazy: {
+            NSRange range = BLEZoneSnapshotReadBlob(reader);
+            return reader->failed ? nil : [[BLEZoneSnapshotDictionary alloc] initWithData:reader->data range:range strings:reader->strings];
+        }
+        case BLEZoneSnapshotParametersValue:
+            return BLEZoneSnapshotReadValue(reader, 0);
+        default:
+            reader->failed = YES;
+            return nil;
+    }
+}
+
++ (BLEConditionExpression *) readExpression:(BLEZoneSnapshotReader *)reader source:(NSString *)source
+{
+    NSRange range = BLEZoneSnapshotReadBlob(reader);
+    if (reader->failed || range.length == 0) {
+        return nil;
+    }
+    NSData *bytecode = [reader->data subdataWithRange:range];
+    return [[BLEConditionExpression alloc] initWithBytecode:bytecode source:source error:nil];
+}
+
++ (BLEBeacon *) readBeaconForZone:(BLEZone *)zone reader:(BLEZoneSnapshotReader *)reader
+{
+    BLEBeacon *beacon = [[BLEBeacon alloc] initWithZone:zone];
+    if (BLEZoneSnapshotReadByte(reader)) {
+        BLEBeaconKey key;
+        memset(&key, 0, sizeof(key));
+        BLEZoneSnapshotReadBytes(reader, key.proximityUUID, sizeof(uuid_t));
+        BLEZoneSnapshotReadBytes(reader, &key.major, sizeof(key.major));
+        BLEZoneSnapshotReadBytes(reader, &key.minor, sizeof(key.minor));
+        key.fields = BLEZoneSnapshotReadByte(reader) & BLEBeaconKeyFieldAll;
+        [beacon setBeaconKey:key];
+    }
+
+    beacon.name = BLEZoneSnapshotReadValue(reader, 0);
+    beacon.desc = BLEZoneSnapshotReadValue(reader, 0);
+    beacon.parameters = [self readParameters:reader];
+    beacon.location = [self readLocation:reader];
+
+    NSUInteger triggersCount = BLEZoneSnapshotReadCount(reader);
+    if (triggersCount > 0) {
+        NSMutableSet *triggers = [NSMutableSet setWithCapacity:triggersCount - 1];
+        for (NSUInteger i = 0; i < triggersCount - 1 && !reader->failed; i++) {
+            BLETrigger *trigger = [self readTriggerForBeacon:beacon reader:reader];
+            if (trigger) {
+                [triggers addObject:trigger];
+            }
+        }
+        beacon.triggers = [triggers copy];
+    }
+    return beacon;
+}
+
++ (BLETrigger *) readTriggerForBeacon:(BLEBeacon *)beacon reader:(BLEZoneSnapshotReader *)reader
+{
+    BLETrigger *trigger = [[BLETrigger alloc] initWithBeacon:beacon];
+    trigger.uniqueIdentifier = BLEZoneSnapshotReadValue(reader, 0);
+    trigger.name = BLEZoneSnapshotReadValue(reader, 0);
+    trigger.comment = BLEZoneSnapshotReadValue(reader, 0);
+
+    if (BLEZoneSnapshotReadByte(reader)) {
+        NSString *actionIdentifier = BLEZoneSnapshotReadValue(reader, 0);
+        if (![actionIdentifier isKindOfClass:[NSString class]]) {
+            reader->failed = YES;
+            return nil;
+        }
+        BLEAction *action = [[BLEAction alloc] initWithUniqueIdentifier:actionIdentifier andTrigger:trigger];
+        action.type = BLEZoneSnapshotReadValue(reader, 0);
+        action.parameters = [self readParameters:reader];
+        trigger.action = action;
+    }
+
+    NSUInteger conditionsCount = BLEZoneSnapshotReadCount(reader);
+    if (conditionsCount > 0) {
+        NSMutableOrderedSet *conditions = [NSMutableOrderedSet orderedSetWithCapacity:conditionsCount - 1];
+        for (NSUInteger i = 0; i < conditionsCount - 1 && !reader->failed; i++) {
+            BLECondition *condition = [[BLECondition alloc] initWithTrigger:trigger];
+            NSString *type = BLEZoneSnapshotReadValue(reader, 0);
+            NSString *expression = BLEZoneSnapshotReadValue(reader, 0);
+            NSDictionary *parameters = BLEZoneSnapshotReadValue(reader, 0);
+            BLEConditionExpression *nativeExpression = [self readExpression:reader source:expression];
+            BLEConditionExpression *nativeParameters = [self readExpression:reader source:nil];
+            BLEConditionExpression *nativeParametersWithoutOccurrence = [self readExpression:reader source:nil];
+            if (reader->failed) {
+                return nil;
+            }
+
+            [condition updateWithType:type parameters:parameters expression:expression nativeExpression:nativeExpression nativeParameters:nativeParameters nativeParametersWithoutOccurrence:nativeParametersWithoutOccurrence];
+            [conditions addObject:condition];
+        }
+        trigger.conditions = [conditions copy];
+    }
+    return trigger;
+}
+
+#pragma mark - Cache
+
++ (NSString *) snapshotPathForJSONAtPath:(NSString *)jsonPath
+{
+    NSData *pathData = [[jsonPath stringByStandardizingPath] dataUsingEncoding:NSUTF8StringEncoding];
+    NSString *cachesPath = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+    NSString *fileName = [NSString stringWithFormat:@"%08x.snapshot", BLEZoneSnapshotChecksum(pathData.bytes, pathData.length)];
+    return [[[cachesPath stringByAppendingPathComponent:@"com.up-next.BLEKit"] stringByAppendingPathComponent:@"zones"] stringByAppendingPathComponent:fileName];
+}
+
++ (BOOL) sourceStamp:(BLEZoneSnapshotSourceStamp *)stamp forJSONAtPath:(NSString *)jsonPath error:(NSError * __autoreleasing *)error
+{
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:jsonPath error:error];
+    if (!attributes) {
+        return NO;
+    }
+    stamp->size = [attributes fileSize];
+    stamp->modificationTime = [[attributes fileModificationDate] timeIntervalSinceReferenceDate];
+    return YES;
+}
+
++ (BLEZone *) cachedZoneForJSONAtPath:(NSString *)jsonPath stamp:(BLEZoneSnapshotSourceStamp)stamp
+{
+    NSData *snapshotData = [NSData dataWithContentsOfFile:[self snapshotPathForJSONAtPath:jsonPath] options:NSDataReadingMappedIfSafe error:nil];
+    BLEZoneSnapshotHeader header;
+    if (snapshotData && [self readHeader:&header fromData:snapshotData] && header.sourceSize == stamp.size && header.sourceModificationTime == stamp.modificationTime) {
+        return [self zoneWithData:snapshotData error:nil];
+    }
+    return nil;
+}
+
++ (BLEZone *) cachedZoneForJSONAtPath:(NSString *)jsonPath
+{
+    NSParameterAssert(jsonPath);
+
+    BLEZoneSnapshotSourceStamp stamp;
+    if (![self sourceStamp:&stamp forJSONAtPath:jsonPath error:nil]) {
+        return nil;
+    }
+    return [self cachedZoneForJSONAtPath:jsonPath stamp:stamp];
+}
+
++ (BLEZone *) zoneWithJSONAtPath:(NSString *)jsonPath error:(NSError * __autoreleasing *)error
+{
+    NSParameterAssert(jsonPath);
+
+    BLEZoneSnapshotSourceStamp stamp;
+    if (![self sourceStamp:&stamp forJSONAtPath:jsonPath error:error]) {
+        return nil;
+    }
+
+    BLEZone *zone = [self cachedZoneForJSONAtPath:jsonPath stamp:stamp];
+    if (zone) {
+        return zone;
+    }
+
+    zone = [BLEZone zoneWithJSONAtPath:jsonPath error:error];
+    if (!zone) {
+        return nil;
+    }
+
+    NSString *snapshotPath = [self snapshotPathForJSONAtPath:jsonPath];
+    NSData *data = [self dataWithZone:zone sourceStamp:stamp];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        [[NSFileManager defaultManager] createDirectoryAtPath:[snapshotPath stringByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nil];
+        [data writeToFile:snapshotPath atomically:YES];
+    });
+    return zone;
+}
+
+#pragma mark - Benchmark
+
+#ifdef DEBUG
++ (void) benchmarkZoneAtPath:(NSString *)jsonPath iterations:(NSUInteger)iterations
+{
+    NSData *jsonData = [NSData dataWithContentsOfFile:jsonPath];
+    BLEZone *zone = jsonData ? [BLEZone zoneWithJSON:jsonData error:nil] : nil;
+    if (!zone) {
+        NSLog(@"%@ Can't load zone %@", self, jsonPath);
+        return;
+    }
+    NSData *snapshotData = [self dataWithZone:zone sourceStamp:(BLEZoneSnapshotSourceStamp){0, 0}];
+
+    NSTimeInterval start = BLEMonotonicTime();
+    for (NSUInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [BLEZone zoneWithJSON:jsonData error:nil];
+        }
+    }
+    NSTimeInterval jsonTime = (BLEMonotonicTime() - start) / MAX(iterations, 1);
+
+    start = BLEMonotonicTime();
+    for (NSUInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            [self zoneWithData:snapshotData error:nil];
+        }
+    }
+    NSTimeInterval snapshotTime = (BLEMonotonicTime() - start) / MAX(iterations, 1);
+
+    NSLog(@"%@ %@ beacons. JSON %@ bytes: %.3f ms, snapshot %@ bytes: %.3f ms (%.1fx faster)", self, @(zone.beacons.count), @(jsonData.length), jsonTime * 1000, @(snapshotData.length), snapshotTime * 1000, snapshotTime > 0 ? jsonTime / snapshotTime : 0);
+}
+#endif
+
+@end
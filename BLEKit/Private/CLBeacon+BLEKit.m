@@ -27,29 +27,25 @@
  */
 
 #import "CLBeacon+BLEKit.h"
+#import "BLEBeaconKey.h"
 
 @implementation CLBeacon (BLEKit)
 
 - (NSString *) blekit_identifier
 {
-    @synchronized(self) {
-        // Build identifier
-        
-        NSMutableArray *arr = [NSMutableArray arrayWithCapacity:3];
-        if (self.proximityUUID) {
-            [arr addObject:self.proximityUUID.UUIDString];
-        }
-        
-        if (self.major) {
-            [arr addObject:self.major];
-        }
-        
-        if (self.minor) {
-            [arr addObject:self.minor];
-        }
-        
-        return [arr componentsJoinedByString:@"+"];
+    if (self.proximityUUID) {
+        return BLEBeaconKeyString(BLEBeaconKeyForBeacon(self));
     }
+
+    // no proximity UUID, not a valid identity
+    NSMutableArray *arr = [NSMutableArray arrayWithCapacity:2];
+    if (self.major) {
+        [arr addObject:self.major];
+    }
+    if (self.minor) {
+        [arr addObject:self.minor];
+    }
+    return [arr componentsJoinedByString:@"+"];
 }
 
 @end